@@ -0,0 +1,255 @@
+/**
+ * @file concurrent_finite_state_machine.hpp
+ * @brief Harmony Finite State Machine safe for concurrent event producers
+ * @date 2026-10-16
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "dense_transition_table.hpp"
+#include "fsm_shared_table.hpp"
+
+namespace fsm
+{
+/**
+ * @class ConcurrentFiniteStateMachine
+ * @brief Finite state machine that many threads can fire events at without locks. The state is a std::atomic and
+ * a transition commits with a compare-and-swap against the state it was looked up from, retrying when another
+ * thread moved the machine in between.
+ *
+ * Every member is linearizable:
+ * - doEvent takes effect at its successful compare-and-swap, or, when it returns false, at the load that saw a
+ *   state without a transition for the trigger. A concurrent history is thus equivalent to some serial order
+ *   of doEvent calls on a FiniteStateMachine.
+ * - doEventFrom takes effect at its single compare-and-swap, it fails rather than retry from another state.
+ * - getCurrentState, isValid and setState act at their single atomic load or store.
+ *
+ * @tparam TEvent Event type, needs a COUNT sentinel or an EnumTraits specialization
+ * @tparam TState State type, needs a COUNT sentinel or an EnumTraits specialization
+ */
+template < typename TEvent, typename TState >
+class ConcurrentFiniteStateMachine
+{
+ public:
+  using TransitionTable = DenseTransitionTable< TEvent, TState >;
+
+  /**
+   * @brief Construct a new Concurrent Finite State Machine object.
+   *
+   * @param fsm_table Valid transition table
+   * @param init_state Initial state
+   */
+  ConcurrentFiniteStateMachine( const std::vector< EventTableEntry< TEvent, TState > >& fsm_table, TState init_state )
+    : ConcurrentFiniteStateMachine( std::make_shared< const TransitionTable >( fsm_table ), init_state )
+  {
+  }
+
+  /**
+   * @brief Construct a new Concurrent Finite State Machine object from a map of states and their triggers/resultant states
+   *
+   * @param fsm_state_vs_event_mapper
+   * @param init_state Initial state
+   */
+  ConcurrentFiniteStateMachine( const std::map< TState, std::map< TEvent, TState > >& fsm_state_vs_event_mapper, TState init_state )
+    : ConcurrentFiniteStateMachine( std::make_shared< const TransitionTable >( fsm_state_vs_event_mapper ), init_state )
+  {
+  }
+
+  /**
+   * @brief Construct a new Concurrent Finite State Machine object on a shared table
+   *
+   * @param table Immutable transition table, refcounted or borrowed
+   * @param init_state Initial state
+   * @throw std::out_of_range if init_state lies outside the TState enum range
+   */
+  ConcurrentFiniteStateMachine( std::shared_ptr< const TransitionTable > table, TState init_state )
+    : current_state_( init_state )
+    , table_( std::move( table ) )
+  {
+    if ( !TransitionTable::isStateInRange( init_state ) )
+    {
+      throw std::out_of_range( "initial state outside of the TState enum range" );
+    }
+  }
+
+  /**
+   * @brief Copies the table and a snapshot of the current state
+   */
+  ConcurrentFiniteStateMachine( const ConcurrentFiniteStateMachine& other )
+    : current_state_( other.getCurrentState() )
+    , table_( other.table_ )
+  {
+  }
+
+  void operator=( const ConcurrentFiniteStateMachine& ) = delete;
+
+  /**
+   * @brief Execute a state machine transition
+   * @param trigger
+   * @return true if the state change was executed successfully
+   */
+  bool doEvent( const TEvent& trigger )
+  {
+    TState from_state;
+    TState to_state;
+    return doEvent( trigger, from_state, to_state );
+  }
+
+  /**
+   * @brief Execute a state machine transition and report the transition this call committed, which may differ
+   * from what getCurrentState returned just before
+   *
+   * @param trigger
+   * @param from_state State the transition was taken from, or the state that rejected the trigger
+   * @param to_state Resultant state, when successful
+   * @return true if the state change was executed successfully
+   */
+  bool doEvent( const TEvent& trigger, TState& from_state, TState& to_state )
+  {
+    from_state = current_state_.load( std::memory_order_acquire );
+    do
+    {
+      if ( !table_->lookup( from_state, trigger, to_state ) )
+      {
+        return false;
+      }
+      // on failure from_state is reloaded with the state another thread committed
+    } while ( !current_state_.compare_exchange_weak( from_state, to_state, std::memory_order_acq_rel, std::memory_order_acquire ) );
+
+    return true;
+  }
+
+  /**
+   * @brief Execute a state machine transition only if the machine is still in expected_state
+   *
+   * @param expected_state State the caller decided on
+   * @param trigger
+   * @return true if the machine was in expected_state and the state change was executed
+   */
+  bool doEventFrom( TState expected_state, const TEvent& trigger )
+  {
+    TState next_state;
+    if ( !table_->lookup( expected_state, trigger, next_state ) )
+    {
+      return false;
+    }
+
+    return current_state_.compare_exchange_strong( expected_state, next_state, std::memory_order_acq_rel, std::memory_order_acquire );
+  }
+
+  /**
+   * @brief Checks whether the current transition event could yield a new state. Another thread may move the
+   * machine before the caller acts on the answer, see doEventFrom.
+   *
+   * @param trigger
+   * @param next_state The next state given this transition
+   * @return true
+   * @return false
+   */
+  bool isValid( const TEvent& trigger, TState& next_state ) const
+  {
+    return table_->lookup( getCurrentState(), trigger, next_state );
+  }
+
+  TState getCurrentState() const
+  {
+    return current_state_.load( std::memory_order_acquire );
+  }
+
+  /**
+   * @brief Force the machine into a state regardless of the table
+   *
+   * @param state New state
+   * @throw std::out_of_range if state lies outside the TState enum range
+   */
+  void setState( TState state )
+  {
+    if ( !TransitionTable::isStateInRange( state ) )
+    {
+      throw std::out_of_range( "state outside of the TState enum range" );
+    }
+
+    current_state_.store( state, std::memory_order_release );
+  }
+
+  bool isLockFree() const
+  {
+    return current_state_.is_lock_free();
+  }
+
+  /**
+   * @brief Events with a transition defined from the current state
+   */
+  const EnumSet< TEvent >& validEvents() const
+  {
+    return validEventsFrom( getCurrentState() );
+  }
+
+  /**
+   * @brief Events with a transition defined from a state, empty for states outside of the enum range
+   */
+  const EnumSet< TEvent >& validEventsFrom( const TState& state ) const
+  {
+    return table_->validEvents( state );
+  }
+
+  /**
+   * @brief States reachable in a single transition from the current state
+   */
+  const EnumSet< TState >& nextStates() const
+  {
+    return nextStatesFrom( getCurrentState() );
+  }
+
+  /**
+   * @brief States reachable in a single transition from a state, empty for states outside of the enum range
+   */
+  const EnumSet< TState >& nextStatesFrom( const TState& state ) const
+  {
+    return table_->nextStates( state );
+  }
+
+  const TransitionTable& getTransitionTable() const
+  {
+    return *table_;
+  }
+
+ protected:
+  std::atomic< TState >                    current_state_;
+  std::shared_ptr< const TransitionTable > table_;
+};
+
+}  // namespace fsm
@@ -0,0 +1,304 @@
+/**
+ * @file dense_finite_state_machine.hpp
+ * @brief Harmony Finite State Machine over a dense transition table
+ * @date 2026-10-16
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "dense_transition_table.hpp"
+#include "fsm_batch.hpp"
+#include "fsm_shared_table.hpp"
+
+namespace fsm
+{
+/**
+ * @class DenseFiniteStateMachine
+ * @brief Finite state machine with the same transition semantics as FiniteStateMachine, but backed by a
+ * DenseTransitionTable and without virtual dispatch. Suited to contiguous enums and high transition rates.
+ *
+ * @tparam TEvent Event type, needs a COUNT sentinel or an EnumTraits specialization
+ * @tparam TState State type, needs a COUNT sentinel or an EnumTraits specialization
+ */
+template < typename TEvent, typename TState >
+class DenseFiniteStateMachine
+{
+ public:
+  using TransitionTable = DenseTransitionTable< TEvent, TState >;
+
+  /**
+   * @brief Construct a new Dense Finite State Machine object.
+   *
+   * @param fsm_table Valid transition table
+   * @param init_state Initial state
+   */
+  DenseFiniteStateMachine( const std::vector< EventTableEntry< TEvent, TState > >& fsm_table, TState init_state )
+    : DenseFiniteStateMachine( std::make_shared< const TransitionTable >( fsm_table ), init_state )
+  {
+  }
+
+  /**
+   * @brief Construct a new Dense Finite State Machine object from a map of states and their triggers/resultant states
+   *
+   * @param fsm_state_vs_event_mapper
+   * @param init_state Initial state
+   */
+  DenseFiniteStateMachine( const std::map< TState, std::map< TEvent, TState > >& fsm_state_vs_event_mapper, TState init_state )
+    : DenseFiniteStateMachine( std::make_shared< const TransitionTable >( fsm_state_vs_event_mapper ), init_state )
+  {
+  }
+
+  /**
+   * @brief Construct a new Dense Finite State Machine object on a table shared with other machines. The machine
+   * is then a pointer plus its current state, and copies share the table as well, see makeSharedTable and borrowTable.
+   *
+   * @param table Immutable transition table, refcounted or borrowed
+   * @param init_state Initial state
+   * @throw std::out_of_range if init_state lies outside the TState enum range
+   */
+  DenseFiniteStateMachine( std::shared_ptr< const TransitionTable > table, TState init_state )
+    : current_state_( init_state )
+    , table_( std::move( table ) )
+  {
+    if ( !TransitionTable::isStateInRange( init_state ) )
+    {
+      throw std::out_of_range( "initial state outside of the TState enum range" );
+    }
+  }
+
+  /**
+   * @brief Execute a state machine transition
+   * @param trigger
+   * @return true if the state change was executed successfully
+   */
+  bool doEvent( const TEvent& trigger )
+  {
+    TState res;
+    if ( isValid( trigger, res ) )
+    {
+      current_state_ = res;
+      return true;
+    }
+
+    return false;
+  }
+
+  /**
+   * @brief Checks whether the current transition event could yield a new state
+   *
+   * @param trigger
+   * @param next_state The next state given this transition
+   * @return true
+   * @return false
+   */
+  bool isValid( const TEvent& trigger, TState& next_state ) const
+  {
+    return table_->lookup( current_state_, trigger, next_state );
+  }
+
+  TState getCurrentState() const
+  {
+    return current_state_;
+  }
+
+  /**
+   * @brief Applies a span of events in one call
+   *
+   * @param first First event
+   * @param last One past the last event
+   * @param policy How invalid events are handled, see BatchPolicy
+   * @param states_out Optional, last - first states, the state after each applied event
+   * @return BatchResult< TState > events applied or index of the offending event, and the final state
+   */
+  BatchResult< TState > doEvents( const TEvent* first,
+                                  const TEvent* last,
+                                  BatchPolicy   policy     = BatchPolicy::STOP_AT_INVALID,
+                                  TState*       states_out = nullptr )
+  {
+    const TransitionTable& table  = *table_;
+    auto                   lookup = [&]( const TState& current, const TEvent& trigger, TState& next_state ) {
+      return table.lookup( current, trigger, next_state );
+    };
+
+    const auto res = applyBatch( current_state_, first, last, policy, states_out, lookup );
+    current_state_ = res.State;
+    return res;
+  }
+
+  /**
+   * @brief Events with a transition defined from the current state
+   */
+  const EnumSet< TEvent >& validEvents() const
+  {
+    return validEventsFrom( current_state_ );
+  }
+
+  /**
+   * @brief Events with a transition defined from a state, empty for states outside of the enum range
+   */
+  const EnumSet< TEvent >& validEventsFrom( const TState& state ) const
+  {
+    return table_->validEvents( state );
+  }
+
+  /**
+   * @brief States reachable in a single transition from the current state
+   */
+  const EnumSet< TState >& nextStates() const
+  {
+    return nextStatesFrom( current_state_ );
+  }
+
+  /**
+   * @brief States reachable in a single transition from a state, empty for states outside of the enum range
+   */
+  const EnumSet< TState >& nextStatesFrom( const TState& state ) const
+  {
+    return table_->nextStates( state );
+  }
+
+  const TransitionTable& getTransitionTable() const
+  {
+    return *table_;
+  }
+
+  const std::shared_ptr< const TransitionTable >& getSharedTransitionTable() const
+  {
+    return table_;
+  }
+
+  /**
+   * @brief A range of events to feed to one machine
+   */
+  struct EventStream
+  {
+    const TEvent* First;
+    const TEvent* Last;
+  };
+
+  /**
+   * @brief Feeds streams[i] to machines[i] for count independent machine/stream pairs. Each stream alone is a chain
+   * of dependent table loads, so up to Lanes pairs are advanced round robin in one loop and the next table entry of
+   * every lane is prefetched, letting the loads of different lanes overlap. The result is the same as calling
+   * doEvent for every event of every stream.
+   *
+   * @tparam Lanes Pairs advanced together, 4 to 8 suits most cores
+   * @param machines count machines, each fed by its own stream
+   * @param streams count streams
+   * @param count Number of machine/stream pairs
+   * @return std::size_t Number of valid transitions across all streams
+   */
+  template < std::size_t Lanes = 4 >
+  static std::size_t stepInterleaved( DenseFiniteStateMachine* machines, const EventStream* streams, std::size_t count )
+  {
+    static_assert( Lanes > 0, "at least one lane is required" );
+
+    std::size_t valid = 0;
+    for ( std::size_t group = 0; group < count; group += Lanes )
+    {
+      const std::size_t lanes = std::min( Lanes, count - group );
+
+      const typename TransitionTable::code_type* codes[Lanes];
+      std::size_t                                state[Lanes];
+      const TEvent*                              next[Lanes];
+      const TEvent*                              last[Lanes];
+      std::size_t                                shortest = SIZE_MAX;
+      for ( std::size_t l = 0; l < lanes; l++ )
+      {
+        codes[l] = machines[group + l].table_->data();
+        state[l] = enumIndex( machines[group + l].current_state_ );
+        next[l]  = streams[group + l].First;
+        last[l]  = streams[group + l].Last;
+        shortest = std::min< std::size_t >( shortest, last[l] - next[l] );
+      }
+
+      // every lane has events for the first shortest rounds, no per lane end checks
+      for ( std::size_t round = 0; round < shortest; round++ )
+      {
+        for ( std::size_t l = 0; l < lanes; l++ )
+        {
+          valid += advance( codes[l], state[l], next[l], last[l] );
+        }
+      }
+
+      // drain the longer streams
+      for ( bool active = true; active; )
+      {
+        active = false;
+        for ( std::size_t l = 0; l < lanes; l++ )
+        {
+          if ( next[l] != last[l] )
+          {
+            valid += advance( codes[l], state[l], next[l], last[l] );
+            active = true;
+          }
+        }
+      }
+
+      for ( std::size_t l = 0; l < lanes; l++ )
+      {
+        machines[group + l].current_state_ = static_cast< TState >( state[l] );
+      }
+    }
+
+    return valid;
+  }
+
+ protected:
+  // one lane step of stepInterleaved, prefetches the table entry the lane reads next
+  static bool advance( const typename TransitionTable::code_type* codes, std::size_t& state, const TEvent*& next, const TEvent* last )
+  {
+    const std::size_t event_idx = enumIndex( *next++ );
+    const auto        res       = event_idx < TransitionTable::EventCount ? codes[state * TransitionTable::EventCount + event_idx]
+                                                                          : TransitionTable::InvalidCode;
+    const bool        valid     = res != TransitionTable::InvalidCode;
+    state                       = valid ? res : state;
+
+#if defined( __GNUC__ )
+    if ( next != last && enumIndex( *next ) < TransitionTable::EventCount )
+    {
+      __builtin_prefetch( codes + state * TransitionTable::EventCount + enumIndex( *next ) );
+    }
+#endif
+    return valid;
+  }
+
+  TState                                   current_state_;
+  std::shared_ptr< const TransitionTable > table_;
+};
+
+}  // namespace fsm
@@ -0,0 +1,231 @@
+/**
+ * @file dense_transition_table.hpp
+ * @brief Harmony FSM flat array transition table for contiguous enums
+ * @date 2026-10-16
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#pragma once
+
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+#include "event_table_entry.hpp"
+#include "fsm_enum_set.hpp"
+#include "fsm_enum_traits.hpp"
+
+namespace fsm
+{
+/**
+ * @class DenseTransitionTable
+ * @brief Transition table stored as a flat states x events array of compact result codes.
+ * A transition is a single indexed load instead of two tree lookups. Both TState and TEvent must
+ * describe a contiguous range through EnumTraits. The events accepted by each state and the states they lead to
+ * are precomputed as bitsets.
+ *
+ * @tparam TEvent Event type
+ * @tparam TState State type
+ */
+template < typename TEvent, typename TState >
+class DenseTransitionTable
+{
+  static_assert( HasEnumTraits< TState >::value, "TState needs a COUNT sentinel or an fsm::EnumTraits specialization" );
+  static_assert( HasEnumTraits< TEvent >::value, "TEvent needs a COUNT sentinel or an fsm::EnumTraits specialization" );
+
+ public:
+  static constexpr std::size_t StateCount = EnumTraits< TState >::count;
+  static constexpr std::size_t EventCount = EnumTraits< TEvent >::count;
+
+  // result code of a transition, the index of the resultant state or InvalidCode
+  using code_type = typename SmallestUnsigned< StateCount >::type;
+
+  static constexpr code_type InvalidCode = static_cast< code_type >( StateCount );
+
+  /**
+   * @brief Construct a new Dense Transition Table object from table rows. Later rows overwrite earlier
+   * rows with the same current state and trigger.
+   *
+   * @param fsm_table Valid transition table
+   * @throw std::out_of_range if a row lies outside the enum ranges
+   */
+  explicit DenseTransitionTable( const std::vector< EventTableEntry< TEvent, TState > >& fsm_table )
+    : codes_( StateCount * EventCount, InvalidCode )
+  {
+    for ( const auto& entry : fsm_table )
+    {
+      set( entry.Current, entry.Trigger, entry.Result );
+    }
+
+    buildSets();
+  }
+
+  /**
+   * @brief Construct a new Dense Transition Table object from a map of states and their triggers/resultant states
+   *
+   * @param fsm_state_vs_event_mapper
+   * @throw std::out_of_range if an entry lies outside the enum ranges
+   */
+  explicit DenseTransitionTable( const std::map< TState, std::map< TEvent, TState > >& fsm_state_vs_event_mapper )
+    : codes_( StateCount * EventCount, InvalidCode )
+  {
+    for ( const auto& state_mapping : fsm_state_vs_event_mapper )
+    {
+      for ( const auto& event_mapping : state_mapping.second )
+      {
+        set( state_mapping.first, event_mapping.first, event_mapping.second );
+      }
+    }
+
+    buildSets();
+  }
+
+  /**
+   * @brief Looks up the transition for a state and event
+   *
+   * @param current Current state
+   * @param trigger Event trigger
+   * @param next_state The next state given this transition
+   * @return true if the transition is defined
+   */
+  bool lookup( const TState& current, const TEvent& trigger, TState& next_state ) const
+  {
+    const std::size_t state_idx = enumIndex( current );
+    const std::size_t event_idx = enumIndex( trigger );
+    if ( state_idx >= StateCount || event_idx >= EventCount )
+    {
+      return false;
+    }
+
+    const code_type res = code( state_idx, event_idx );
+    if ( res == InvalidCode )
+    {
+      return false;
+    }
+
+    next_state = static_cast< TState >( res );
+    return true;
+  }
+
+  /**
+   * @brief Raw result code for in-range indices, no bounds checking
+   */
+  code_type code( std::size_t state_idx, std::size_t event_idx ) const
+  {
+    return codes_[state_idx * EventCount + event_idx];
+  }
+
+  /**
+   * @brief Row major states x events array of result codes
+   */
+  const code_type* data() const
+  {
+    return codes_.data();
+  }
+
+  /**
+   * @brief Events with a transition defined from a state
+   *
+   * @param current State to query, an empty set is returned for states outside of the enum range
+   */
+  const EnumSet< TEvent >& validEvents( const TState& current ) const
+  {
+    return valid_events_[rowIndex( current )];
+  }
+
+  /**
+   * @brief States reachable in a single transition from a state
+   *
+   * @param current State to query, an empty set is returned for states outside of the enum range
+   */
+  const EnumSet< TState >& nextStates( const TState& current ) const
+  {
+    return next_states_[rowIndex( current )];
+  }
+
+  static bool isStateInRange( const TState& state )
+  {
+    return enumIndex( state ) < StateCount;
+  }
+
+  static bool isEventInRange( const TEvent& trigger )
+  {
+    return enumIndex( trigger ) < EventCount;
+  }
+
+ private:
+  void set( const TState& current, const TEvent& trigger, const TState& result )
+  {
+    if ( !isStateInRange( current ) || !isEventInRange( trigger ) || !isStateInRange( result ) )
+    {
+      throw std::out_of_range( "transition table entry outside of the TState/TEvent enum range" );
+    }
+
+    codes_[enumIndex( current ) * EventCount + enumIndex( trigger )] = static_cast< code_type >( enumIndex( result ) );
+  }
+
+  // rows of the set tables, the extra last row stays empty for states outside of the range
+  static std::size_t rowIndex( const TState& state )
+  {
+    return isStateInRange( state ) ? enumIndex( state ) : StateCount;
+  }
+
+  void buildSets()
+  {
+    valid_events_.assign( StateCount + 1, EnumSet< TEvent >() );
+    next_states_.assign( StateCount + 1, EnumSet< TState >() );
+    for ( std::size_t state_idx = 0; state_idx < StateCount; state_idx++ )
+    {
+      for ( std::size_t event_idx = 0; event_idx < EventCount; event_idx++ )
+      {
+        const code_type res = code( state_idx, event_idx );
+        if ( res != InvalidCode )
+        {
+          valid_events_[state_idx].set( static_cast< TEvent >( event_idx ) );
+          next_states_[state_idx].set( static_cast< TState >( res ) );
+        }
+      }
+    }
+  }
+
+  std::vector< code_type >         codes_;
+  std::vector< EnumSet< TEvent > > valid_events_;
+  std::vector< EnumSet< TState > > next_states_;
+};
+
+template < typename TEvent, typename TState >
+constexpr std::size_t DenseTransitionTable< TEvent, TState >::StateCount;
+
+template < typename TEvent, typename TState >
+constexpr std::size_t DenseTransitionTable< TEvent, TState >::EventCount;
+
+template < typename TEvent, typename TState >
+constexpr typename DenseTransitionTable< TEvent, TState >::code_type DenseTransitionTable< TEvent, TState >::InvalidCode;
+
+}  // namespace fsm
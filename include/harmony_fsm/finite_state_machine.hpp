@@ -35,9 +35,12 @@
 #pragma once
 
 #include <map>
+#include <memory>
 #include <vector>
 
 #include "event_table_entry.hpp"
+#include "fsm_batch.hpp"
+#include "fsm_shared_table.hpp"
 
 namespace fsm
 {
@@ -51,6 +54,9 @@ template < typename TEvent, typename TState >
 class FiniteStateMachine
 {
  public:
+  // map of states and their triggers/resultant states
+  using TransitionMap = std::map< TState, std::map< TEvent, TState > >;
+
   /**
    * @brief Construct a new Finite State Machine object.
    * 
@@ -59,12 +65,8 @@ class FiniteStateMachine
    */
   FiniteStateMachine( std::vector< EventTableEntry< TEvent, TState > > fsm_table, TState init_state )
     : current_state_( init_state )
+    , fsm_state_vs_event_mapper_( std::make_shared< const TransitionMap >( buildTransitionMap( fsm_table ) ) )
   {
-    // an optimization for large event table lookups, map by state and event
-    for ( const auto& entry : fsm_table )
-    {
-      fsm_state_vs_event_mapper_[entry.Current][entry.Trigger] = entry.Result;
-    }
   }
 
   /**
@@ -73,14 +75,43 @@ class FiniteStateMachine
    * @param fsm_state_vs_event_mapper 
    * @param init_state 
    */
-  FiniteStateMachine( std::map< TState, std::map< TEvent, TState > > fsm_state_vs_event_mapper, TState init_state )
+  FiniteStateMachine( TransitionMap fsm_state_vs_event_mapper, TState init_state )
+  : current_state_( init_state )
+  , fsm_state_vs_event_mapper_( std::make_shared< const TransitionMap >( std::move( fsm_state_vs_event_mapper ) ) )
+  {}
+
+  /**
+   * @brief Construct a new Finite State Machine object on a table shared with other machines. Copies of the
+   * machine share the table as well, see makeSharedTable and borrowTable.
+   * 
+   * @param fsm_state_vs_event_mapper Immutable table, refcounted or borrowed
+   * @param init_state 
+   */
+  FiniteStateMachine( std::shared_ptr< const TransitionMap > fsm_state_vs_event_mapper, TState init_state )
   : current_state_( init_state )
   , fsm_state_vs_event_mapper_( std::move( fsm_state_vs_event_mapper ) )
   {}
-  
 
   FiniteStateMachine( const FiniteStateMachine& other ) = default;
 
+  /**
+   * @brief Maps table rows by state and event, an optimization for large event table lookups. Later rows
+   * overwrite earlier rows with the same current state and trigger.
+   * 
+   * @param fsm_table 
+   * @return TransitionMap 
+   */
+  static TransitionMap buildTransitionMap( const std::vector< EventTableEntry< TEvent, TState > >& fsm_table )
+  {
+    TransitionMap fsm_state_vs_event_mapper;
+    for ( const auto& entry : fsm_table )
+    {
+      fsm_state_vs_event_mapper[entry.Current][entry.Trigger] = entry.Result;
+    }
+
+    return fsm_state_vs_event_mapper;
+  }
+
   /**
    * @brief Execute a state machine transition
    * @param trigger
@@ -108,8 +139,8 @@ class FiniteStateMachine
    */
   virtual bool isValid( const TEvent& trigger, TState& next_state ) const
   {
-    const auto state_mapping = fsm_state_vs_event_mapper_.find( current_state_ );
-    if ( state_mapping != end( fsm_state_vs_event_mapper_ ) )
+    const auto state_mapping = fsm_state_vs_event_mapper_->find( current_state_ );
+    if ( state_mapping != end( *fsm_state_vs_event_mapper_ ) )
     {
       const auto event_mapping = state_mapping->second.find( trigger );
       if ( event_mapping != end( state_mapping->second ) )
@@ -122,19 +153,71 @@ class FiniteStateMachine
     return false;
   }
 
+  /**
+   * @brief Applies a span of events in one non-virtual call
+   *
+   * @param first First event
+   * @param last One past the last event
+   * @param policy How invalid events are handled, see BatchPolicy
+   * @param states_out Optional, last - first states, the state after each applied event
+   * @return BatchResult< TState > events applied or index of the offending event, and the final state
+   */
+  BatchResult< TState > doEvents( const TEvent* first,
+                                  const TEvent* last,
+                                  BatchPolicy   policy     = BatchPolicy::STOP_AT_INVALID,
+                                  TState*       states_out = nullptr )
+  {
+    // the events of a state are looked up again only once the state changes
+    const TransitionMap& table         = *fsm_state_vs_event_mapper_;
+    auto                 state_mapping = table.find( current_state_ );
+    auto                 lookup        = [&]( const TState& current, const TEvent& trigger, TState& next_state ) {
+      if ( state_mapping == end( table ) || state_mapping->first != current )
+      {
+        state_mapping = table.find( current );
+        if ( state_mapping == end( table ) )
+        {
+          return false;
+        }
+      }
+
+      const auto event_mapping = state_mapping->second.find( trigger );
+      if ( event_mapping == end( state_mapping->second ) )
+      {
+        return false;
+      }
+
+      next_state = event_mapping->second;
+      return true;
+    };
+
+    const auto res = applyBatch( current_state_, first, last, policy, states_out, lookup );
+    current_state_ = res.State;
+    return res;
+  }
+
   virtual TState getCurrentState() const
   {
     return current_state_;
   }
 
+  const TransitionMap& getTransitionTable() const
+  {
+    return *fsm_state_vs_event_mapper_;
+  }
+
+  const std::shared_ptr< const TransitionMap >& getSharedTransitionTable() const
+  {
+    return fsm_state_vs_event_mapper_;
+  }
+
   virtual ~FiniteStateMachine()
   {
   }
 
  protected:
-  TState                                         current_state_;
-  // map of states and their triggers/resultant states
-  std::map< TState, std::map< TEvent, TState > > fsm_state_vs_event_mapper_;
+  TState                                 current_state_;
+  // immutable map of states and their triggers/resultant states, shared between copies
+  std::shared_ptr< const TransitionMap > fsm_state_vs_event_mapper_;
 };
 
 }  // namespace fsm
@@ -0,0 +1,105 @@
+/**
+ * @file fsm_batch.hpp
+ * @brief Harmony FSM batch event application policies
+ * @date 2026-10-16
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace fsm
+{
+/**
+ * @brief How a batch of events treats an invalid event
+ */
+enum class BatchPolicy
+{
+  STOP_AT_INVALID,  // apply events up to the first invalid one
+  SKIP_INVALID,     // invalid events leave the state unchanged, the rest of the batch is applied
+  ATOMIC            // apply every event or none of them
+};
+
+/**
+ * @brief Outcome of applying a batch of events
+ */
+template < typename TState >
+struct BatchResult
+{
+  // number of events applied, or the index of the invalid event that stopped or rejected the batch
+  std::size_t Index;
+  // state of the machine after the batch
+  TState State;
+};
+
+/**
+ * @brief Applies a span of events from a start state under a batch policy. With ATOMIC, a rejected batch reports the
+ * start state, states_out then holds the states the batch passed through up to Index.
+ *
+ * @param state Start state
+ * @param first First event
+ * @param last One past the last event
+ * @param policy How invalid events are handled
+ * @param states_out Optional, last - first states, the state after each applied event
+ * @param lookup bool( const TState& current, const TEvent& trigger, TState& next_state )
+ * @return BatchResult< TState >
+ */
+template < typename TEvent, typename TState, typename TLookup >
+BatchResult< TState > applyBatch(
+    TState state, const TEvent* first, const TEvent* last, BatchPolicy policy, TState* states_out, TLookup&& lookup )
+{
+  const TState start = state;
+  const auto   count = static_cast< std::size_t >( last - first );
+  for ( std::size_t i = 0; i < count; i++ )
+  {
+    TState next = state;
+    if ( lookup( state, first[i], next ) )
+    {
+      state = next;
+    }
+    else if ( policy == BatchPolicy::STOP_AT_INVALID )
+    {
+      return { i, state };
+    }
+    else if ( policy == BatchPolicy::ATOMIC )
+    {
+      return { i, start };
+    }
+
+    if ( states_out )
+    {
+      states_out[i] = state;
+    }
+  }
+
+  return { count, state };
+}
+
+}  // namespace fsm
@@ -34,6 +34,11 @@
 
 #pragma once
 #include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
 
 #ifdef USE_ROS_TIME
 #include <ros/ros.h>
@@ -41,13 +46,91 @@
 
 namespace fsm {
 
+/**
+ * @brief Rounds seconds to the nearest nanosecond. Infinity, NaN and values out of range saturate, so an infinite
+ * timeout stays nanoseconds::max().
+ */
+inline std::chrono::nanoseconds toNanoseconds(double seconds)
+{
+  const double count = std::round(seconds * 1e9);
+  if (!(count < static_cast<double>(std::chrono::nanoseconds::max().count())))
+  {
+    return seconds < 0 ? std::chrono::nanoseconds::min() : std::chrono::nanoseconds::max();
+  }
+  if (count <= static_cast<double>(std::chrono::nanoseconds::min().count()))
+  {
+    return std::chrono::nanoseconds::min();
+  }
+  return std::chrono::nanoseconds(static_cast<std::int64_t>(count));
+}
+
+/**
+ * @brief Converts a std::chrono duration to nanoseconds, exact for integer durations in range and saturating like
+ * toNanoseconds( double ) otherwise
+ */
+template <typename TRep, typename TPeriod>
+std::chrono::nanoseconds toNanoseconds(std::chrono::duration<TRep, TPeriod> duration)
+{
+  const double seconds = std::chrono::duration<double>(duration).count();
+  if (std::is_floating_point<TRep>::value || !(std::abs(seconds) < 9.2e9))
+  {
+    return toNanoseconds(seconds);
+  }
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(duration);
+}
+
+inline double toSeconds(std::chrono::nanoseconds duration)
+{
+  return std::chrono::duration<double>(duration).count();
+}
+
+/**
+ * @brief std::chrono clock reading the time of an FSM clock, lets the integer rates and timers run on virtual and
+ * cycle clocks
+ *
+ * @tparam TClock FSM clock providing sinceEpoch
+ */
+template <typename TClock>
+struct FSMChronoClock
+{
+  using duration   = std::chrono::nanoseconds;
+  using rep        = duration::rep;
+  using period     = duration::period;
+  using time_point = std::chrono::time_point<FSMChronoClock, duration>;
+
+  static constexpr bool is_steady = false;
+
+  static time_point now()
+  {
+    return time_point(TClock::sinceEpoch());
+  }
+};
+
+template <typename TClock>
+constexpr bool FSMChronoClock<TClock>::is_steady;
+
 template <typename TChrono>
 class FSMSTLBaseClock
 {
 public:
+  using ChronoClock = TChrono;
+
   static double toSec()
   {
-    return std::chrono::duration<double>(TChrono::now().time_since_epoch()).count();
+    return toSeconds(sinceEpoch());
+  }
+
+  /**
+   * @brief Integer time since the epoch of TChrono, exact where toSec rounds to the resolution of a double
+   */
+  static std::chrono::nanoseconds sinceEpoch()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(TChrono::now().time_since_epoch());
+  }
+
+  static typename TChrono::time_point now()
+  {
+    return TChrono::now();
   }
 };
 
@@ -55,19 +138,289 @@ using FSMSteadyClock = FSMSTLBaseClock<std::chrono::steady_clock>;
 using FSMHighResClock = FSMSTLBaseClock<std::chrono::high_resolution_clock>;
 using FSMSystemClock = FSMSTLBaseClock<std::chrono::system_clock>;
 
+/**
+ * @brief Controllable clock for tests and simulation. Each TTag has its own time source, which starts at 0 and
+ * runs at scale times wall time. With the default scale of 0 time only moves through set, advance and sleeping:
+ * a BaseRate or BaseTimer on this clock advances the time to the end of its sleep instead of waiting.
+ *
+ * @tparam TTag Selects an independent time source
+ */
+template <typename TTag = void>
+class FSMVirtualBaseClock
+{
+public:
+  using ChronoClock = FSMChronoClock<FSMVirtualBaseClock>;
+
+  static double toSec()
+  {
+    return toSeconds(sinceEpoch());
+  }
+
+  static std::chrono::nanoseconds sinceEpoch()
+  {
+    State& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    return now(state);
+  }
+
+  /**
+   * @brief Jumps to the given time, forwards or backwards
+   */
+  static void set(double seconds)
+  {
+    set(toNanoseconds(seconds));
+  }
+
+  static void set(std::chrono::nanoseconds since_epoch)
+  {
+    State& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    rebase(state, since_epoch);
+  }
+
+  static void advance(double seconds)
+  {
+    advance(toNanoseconds(seconds));
+  }
+
+  static void advance(std::chrono::nanoseconds duration)
+  {
+    State& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    rebase(state, now(state) + duration);
+  }
+
+  /**
+   * @brief Sets the speed of time relative to wall time, 0 stops it
+   */
+  static void setScale(double scale)
+  {
+    State& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    rebase(state, now(state));
+    state.scale = scale;
+  }
+
+  static double getScale()
+  {
+    State& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    return state.scale;
+  }
+
+  /**
+   * @brief Advances a stopped clock by duration, otherwise waits for it to pass at the current scale
+   */
+  static void sleepFor(std::chrono::nanoseconds duration)
+  {
+    if (duration <= std::chrono::nanoseconds::zero())
+    {
+      return;
+    }
+
+    const std::chrono::nanoseconds wall = wallTime(duration);
+    if (wall > std::chrono::nanoseconds::zero())
+    {
+      std::this_thread::sleep_for(wall);
+    }
+  }
+
+  static void sleepFor(double seconds)
+  {
+    sleepFor(toNanoseconds(seconds));
+  }
+
+  /**
+   * @brief Wall time for duration of this clock to pass. A stopped clock is advanced by duration right away and
+   * 0 is returned.
+   */
+  static std::chrono::nanoseconds wallTime(std::chrono::nanoseconds duration)
+  {
+    State& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (state.scale <= 0)
+    {
+      rebase(state, now(state) + duration);
+      return std::chrono::nanoseconds::zero();
+    }
+    return toNanoseconds(toSeconds(duration) / state.scale);
+  }
+
+private:
+  struct State
+  {
+    std::mutex                            mutex;
+    std::chrono::nanoseconds              base{0};
+    double                                scale  = 0;
+    std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+  };
+
+  static State& getState()
+  {
+    static State state;
+    return state;
+  }
+
+  static std::chrono::nanoseconds now(const State& state)
+  {
+    if (state.scale <= 0)
+    {
+      return state.base;
+    }
+    return state.base + toNanoseconds(state.scale * toSeconds(std::chrono::steady_clock::now() - state.origin));
+  }
+
+  static void rebase(State& state, std::chrono::nanoseconds since_epoch)
+  {
+    state.origin = std::chrono::steady_clock::now();
+    state.base   = since_epoch;
+  }
+};
+
+using FSMVirtualClock = FSMVirtualBaseClock<>;
+
+/**
+ * @brief Per-cycle snapshot of TClock. Runners on TClock read the clock once per step and publish that time on the
+ * executing thread for the duration of the step, as does the TimeoutSupervisor while firing. toSec returns the
+ * published time there and reads TClock anywhere else, so the state functions, timers and rates on this clock
+ * agree on one "now" per step without reading the clock again.
+ *
+ * @tparam TClock Clock of the runner
+ */
+template <typename TClock>
+class FSMCycleBaseClock
+{
+  struct Snapshot
+  {
+    std::chrono::nanoseconds now{0};
+    bool                     published = false;
+  };
+
+public:
+  using ChronoClock = FSMChronoClock<FSMCycleBaseClock>;
+
+  static double toSec()
+  {
+    return toSeconds(sinceEpoch());
+  }
+
+  static std::chrono::nanoseconds sinceEpoch()
+  {
+    const Snapshot& snapshot = getSnapshot();
+    return snapshot.published ? snapshot.now : TClock::sinceEpoch();
+  }
+
+  /**
+   * @brief Whether a time is published on this thread
+   */
+  static bool published()
+  {
+    return getSnapshot().published;
+  }
+
+  /**
+   * @brief Publishes now on this thread until destroyed, restoring the time published before
+   */
+  class Scope
+  {
+  public:
+    explicit Scope(std::chrono::nanoseconds now)
+      : previous_(getSnapshot())
+    {
+      getSnapshot() = {now, true};
+    }
+
+    explicit Scope(double now)
+      : Scope(toNanoseconds(now))
+    {
+    }
+
+    Scope(const Scope&) = delete;
+    void operator=(const Scope&) = delete;
+
+    ~Scope()
+    {
+      getSnapshot() = previous_;
+    }
+
+  private:
+    Snapshot previous_;
+  };
+
+private:
+  static Snapshot& getSnapshot()
+  {
+    thread_local Snapshot snapshot;
+    return snapshot;
+  }
+};
+
+using FSMSteadyCycleClock = FSMCycleBaseClock<FSMSteadyClock>;
+using FSMVirtualCycleClock = FSMCycleBaseClock<FSMVirtualClock>;
+
 #ifdef USE_ROS_TIME
 template <typename TROS>
 class FSMROSBaseClock
 {
 public:
+  using ChronoClock = FSMChronoClock<FSMROSBaseClock>;
+
   static double toSec()
   {
     return TROS::now().toSec();
   }
+
+  static std::chrono::nanoseconds sinceEpoch()
+  {
+    return std::chrono::nanoseconds(TROS::now().toNSec());
+  }
 };
 
 using FSMROSClock = FSMROSBaseClock<ros::Time>;
+using FSMROSCycleClock = FSMCycleBaseClock<FSMROSClock>;
 
 #endif
 
-}
\ No newline at end of file
+/**
+ * @brief How threads wait for time of TClock to pass. Real clocks sleep for the time itself.
+ */
+template <typename TClock>
+struct ClockTraits
+{
+  static void sleepFor(std::chrono::nanoseconds duration)
+  {
+    std::this_thread::sleep_for(duration);
+  }
+
+  /**
+   * @brief Longest wall time to block, e.g. on a condition variable, before duration of TClock has passed
+   */
+  static std::chrono::nanoseconds waitFor(std::chrono::nanoseconds duration)
+  {
+    return duration;
+  }
+};
+
+template <typename TTag>
+struct ClockTraits<FSMVirtualBaseClock<TTag>>
+{
+  static void sleepFor(std::chrono::nanoseconds duration)
+  {
+    FSMVirtualBaseClock<TTag>::sleepFor(duration);
+  }
+
+  // a stopped clock is only moved by other threads, poll it
+  static std::chrono::nanoseconds waitFor(std::chrono::nanoseconds duration)
+  {
+    const double scale = FSMVirtualBaseClock<TTag>::getScale();
+    return scale > 0 ? toNanoseconds(toSeconds(duration) / scale) : std::chrono::milliseconds(1);
+  }
+};
+
+// the snapshot only stands in for reading the time, waiting is done on TClock
+template <typename TClock>
+struct ClockTraits<FSMCycleBaseClock<TClock>> : ClockTraits<TClock>
+{
+};
+
+}
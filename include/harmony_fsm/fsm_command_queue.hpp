@@ -0,0 +1,304 @@
+/**
+ * @file fsm_command_queue.hpp
+ * @brief Bounded lock-free command queue with overflow policies
+ * @date 2026-10-16
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+namespace fsm
+{
+/**
+ * @brief What a push does when the command queue is full
+ */
+enum class OverflowPolicy
+{
+  BLOCK,        // wait for the consumer to make room
+  DROP_OLDEST,  // discard the oldest pending command to make room
+  DROP_NEWEST,  // discard the command being pushed
+  COALESCE      // discard every pending command, only the newest one is kept
+};
+
+/**
+ * @class BoundedCommandQueue
+ * @brief Fixed depth ring buffer of commands. Pushes and pops are lock-free, based on Dmitry Vyukov's bounded
+ * MPMC queue: every cell carries a sequence number telling producers and consumers whose turn it is. Sequence
+ * numbers advance by two per position, 2 * pos free for the producer of pos and 2 * pos + 1 full for its
+ * consumer, so a full cell is never mistaken for a free one of the next lap, even at a depth of one. Producers
+ * only take a lock when they block on a full queue under OverflowPolicy::BLOCK.
+ *
+ * @tparam T Command type, default constructible and move assignable
+ */
+template < typename T >
+class BoundedCommandQueue
+{
+ public:
+  /**
+   * @brief Construct a new Bounded Command Queue object
+   *
+   * @param depth Number of commands that can be pending
+   * @throw std::invalid_argument if depth is zero
+   */
+  explicit BoundedCommandQueue( std::size_t depth )
+    : depth_( depth )
+  {
+    if ( depth == 0 )
+    {
+      throw std::invalid_argument( "command queue depth must be at least one" );
+    }
+
+    cells_.reset( new Cell[depth] );
+    for ( std::size_t i = 0; i < depth; i++ )
+    {
+      cells_[i].sequence.store( 2 * i, std::memory_order_relaxed );
+    }
+  }
+
+  BoundedCommandQueue( const BoundedCommandQueue& ) = delete;
+  void operator=( const BoundedCommandQueue& ) = delete;
+
+  /**
+   * @brief Adds a command, applying the overflow policy when the queue is full
+   *
+   * @param value Command, left untouched when it is not queued
+   * @param policy What to do when the queue is full
+   * @return true if the command was queued, false if it was dropped or the queue was closed while blocking
+   */
+  bool push( T&& value, OverflowPolicy policy )
+  {
+    switch ( policy )
+    {
+      case OverflowPolicy::DROP_NEWEST:
+        if ( !tryPush( std::move( value ) ) )
+        {
+          dropped_++;
+          return false;
+        }
+        return true;
+
+      case OverflowPolicy::BLOCK:
+        return pushBlocking( std::move( value ) );
+
+      case OverflowPolicy::COALESCE:
+        discardPending();
+        break;
+
+      case OverflowPolicy::DROP_OLDEST:
+        break;
+    }
+
+    // room is made by popping on behalf of the consumer
+    while ( !tryPush( std::move( value ) ) )
+    {
+      T discarded;
+      if ( tryPop( discarded ) )
+      {
+        dropped_++;
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * @brief Adds a command if there is room
+   *
+   * @param value Command, left untouched when the queue is full
+   * @return true if the command was queued
+   */
+  bool tryPush( T&& value )
+  {
+    std::size_t pos = enqueue_pos_.load( std::memory_order_relaxed );
+    for ( ;; )
+    {
+      Cell&                cell = cells_[pos % depth_];
+      const std::size_t    seq  = cell.sequence.load( std::memory_order_acquire );
+      const std::ptrdiff_t dif  = static_cast< std::ptrdiff_t >( seq ) - static_cast< std::ptrdiff_t >( 2 * pos );
+      if ( dif == 0 )
+      {
+        if ( enqueue_pos_.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) )
+        {
+          cell.value = std::move( value );
+          cell.sequence.store( 2 * pos + 1, std::memory_order_release );
+          return true;
+        }
+      }
+      else if ( dif < 0 )
+      {
+        return false;  // full, the cell still holds a command from the previous lap
+      }
+      else
+      {
+        pos = enqueue_pos_.load( std::memory_order_relaxed );
+      }
+    }
+  }
+
+  /**
+   * @brief Takes the oldest command
+   *
+   * @param value Receives the command
+   * @return true if a command was pending
+   */
+  bool tryPop( T& value )
+  {
+    std::size_t pos = dequeue_pos_.load( std::memory_order_relaxed );
+    for ( ;; )
+    {
+      Cell&                cell = cells_[pos % depth_];
+      const std::size_t    seq  = cell.sequence.load( std::memory_order_acquire );
+      const std::ptrdiff_t dif  = static_cast< std::ptrdiff_t >( seq ) - static_cast< std::ptrdiff_t >( 2 * pos + 1 );
+      if ( dif == 0 )
+      {
+        if ( dequeue_pos_.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) )
+        {
+          value = std::move( cell.value );
+          cell.sequence.store( 2 * ( pos + depth_ ), std::memory_order_release );
+          notifyBlocked();
+          return true;
+        }
+      }
+      else if ( dif < 0 )
+      {
+        return false;  // empty, or the next command is still being written
+      }
+      else
+      {
+        pos = dequeue_pos_.load( std::memory_order_relaxed );
+      }
+    }
+  }
+
+  /**
+   * @brief Releases producers blocked on a full queue, pushes fail until open is called
+   */
+  void close()
+  {
+    std::lock_guard< std::mutex > lock( space_mutex_ );
+    closed_ = true;
+    space_cond_.notify_all();
+  }
+
+  void open()
+  {
+    std::lock_guard< std::mutex > lock( space_mutex_ );
+    closed_ = false;
+  }
+
+  /**
+   * @brief Whether no command is pending, a snapshot that may be stale by the time it returns
+   */
+  bool empty() const
+  {
+    const std::size_t dequeue_pos = dequeue_pos_.load( std::memory_order_acquire );
+    return enqueue_pos_.load( std::memory_order_acquire ) == dequeue_pos;
+  }
+
+  std::size_t depth() const
+  {
+    return depth_;
+  }
+
+  /**
+   * @brief Number of commands discarded by the overflow policies so far
+   */
+  std::size_t dropped() const
+  {
+    return dropped_;
+  }
+
+ private:
+  struct Cell
+  {
+    std::atomic< std::size_t > sequence;
+    T                          value;
+  };
+
+  bool pushBlocking( T&& value )
+  {
+    if ( tryPush( std::move( value ) ) )
+    {
+      return true;
+    }
+
+    std::unique_lock< std::mutex > lock( space_mutex_ );
+    blocked_producers_++;
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+
+    bool pushed = false;
+    space_cond_.wait( lock, [&]() { return ( pushed = tryPush( std::move( value ) ) ) || closed_; } );
+    blocked_producers_--;
+    return pushed;
+  }
+
+  // only pays for the lock when a producer is waiting for room
+  void notifyBlocked()
+  {
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    if ( blocked_producers_.load( std::memory_order_relaxed ) > 0 )
+    {
+      std::lock_guard< std::mutex > lock( space_mutex_ );
+      space_cond_.notify_all();
+    }
+  }
+
+  void discardPending()
+  {
+    T discarded;
+    while ( tryPop( discarded ) )
+    {
+      dropped_++;
+    }
+  }
+
+  const std::size_t         depth_;
+  std::unique_ptr< Cell[] > cells_;
+
+  // producer and consumer positions on separate cache lines
+  std::atomic< std::size_t > enqueue_pos_{ 0 };
+  char                       enqueue_padding_[64];
+  std::atomic< std::size_t > dequeue_pos_{ 0 };
+  char                       dequeue_padding_[64];
+
+  std::atomic< std::size_t > dropped_{ 0 };
+  std::atomic< std::size_t > blocked_producers_{ 0 };
+  std::mutex                 space_mutex_;
+  std::condition_variable    space_cond_;
+  bool                       closed_ = false;
+};
+
+}  // namespace fsm
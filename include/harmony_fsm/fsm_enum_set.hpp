@@ -0,0 +1,191 @@
+/**
+ * @file fsm_enum_set.hpp
+ * @brief Bitset of enum values with an iterable view
+ * @date 2026-10-16
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#pragma once
+
+#include <bitset>
+#include <iterator>
+
+#include "fsm_enum_traits.hpp"
+
+namespace fsm
+{
+/**
+ * @class EnumSet
+ * @brief Fixed size bitset of the values of an enum with an EnumTraits range. Iterating yields the members
+ * in ascending order.
+ *
+ * @tparam TEnum enum type
+ */
+template < typename TEnum >
+class EnumSet
+{
+  static_assert( HasEnumTraits< TEnum >::value, "TEnum needs a COUNT sentinel or an fsm::EnumTraits specialization" );
+
+ public:
+  static constexpr std::size_t Size = EnumTraits< TEnum >::count;
+
+  using bitset_type = std::bitset< Size >;
+
+  class const_iterator
+  {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = TEnum;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = const TEnum*;
+    using reference         = TEnum;
+
+    const_iterator( const bitset_type* bits, std::size_t idx )
+      : bits_( bits )
+      , idx_( idx )
+    {
+      skip();
+    }
+
+    TEnum operator*() const
+    {
+      return static_cast< TEnum >( idx_ );
+    }
+
+    const_iterator& operator++()
+    {
+      idx_++;
+      skip();
+      return *this;
+    }
+
+    const_iterator operator++( int )
+    {
+      const_iterator res = *this;
+      ++*this;
+      return res;
+    }
+
+    bool operator==( const const_iterator& other ) const
+    {
+      return idx_ == other.idx_;
+    }
+
+    bool operator!=( const const_iterator& other ) const
+    {
+      return idx_ != other.idx_;
+    }
+
+   private:
+    void skip()
+    {
+      while ( idx_ < Size && !bits_->test( idx_ ) )
+      {
+        idx_++;
+      }
+    }
+
+    const bitset_type* bits_;
+    std::size_t        idx_;
+  };
+
+  EnumSet() = default;
+
+  explicit EnumSet( const bitset_type& bits )
+    : bits_( bits )
+  {
+  }
+
+  /**
+   * @brief Adds a value, values outside of the enum range are ignored
+   */
+  void set( TEnum value )
+  {
+    if ( enumIndex( value ) < Size )
+    {
+      bits_.set( enumIndex( value ) );
+    }
+  }
+
+  /**
+   * @brief Whether the value is a member, false for values outside of the enum range
+   */
+  bool test( TEnum value ) const
+  {
+    return enumIndex( value ) < Size && bits_.test( enumIndex( value ) );
+  }
+
+  std::size_t count() const
+  {
+    return bits_.count();
+  }
+
+  bool any() const
+  {
+    return bits_.any();
+  }
+
+  bool none() const
+  {
+    return bits_.none();
+  }
+
+  const bitset_type& bits() const
+  {
+    return bits_;
+  }
+
+  const_iterator begin() const
+  {
+    return const_iterator( &bits_, 0 );
+  }
+
+  const_iterator end() const
+  {
+    return const_iterator( &bits_, Size );
+  }
+
+  bool operator==( const EnumSet& other ) const
+  {
+    return bits_ == other.bits_;
+  }
+
+  bool operator!=( const EnumSet& other ) const
+  {
+    return bits_ != other.bits_;
+  }
+
+ private:
+  bitset_type bits_;
+};
+
+template < typename TEnum >
+constexpr std::size_t EnumSet< TEnum >::Size;
+
+}  // namespace fsm
@@ -0,0 +1,106 @@
+/**
+ * @file fsm_enum_traits.hpp
+ * @brief Harmony FSM compile time enum range and storage traits
+ * @date 2026-10-16
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace fsm
+{
+namespace detail
+{
+template < typename T >
+struct MakeVoid
+{
+  using type = void;
+};
+}  // namespace detail
+
+/**
+ * @brief Describes the contiguous range [0, count) of an enum used as a TState or TEvent.
+ * Enums ending with a COUNT sentinel are picked up automatically, otherwise specialize:
+ *
+ * template <> struct fsm::EnumTraits< RUNSTATE > { static constexpr std::size_t count = 4; };
+ *
+ * @tparam TEnum enum type
+ */
+template < typename TEnum, typename Enable = void >
+struct EnumTraits
+{
+};
+
+template < typename TEnum >
+struct EnumTraits< TEnum, typename detail::MakeVoid< decltype( TEnum::COUNT ) >::type >
+{
+  static constexpr std::size_t count = static_cast< std::size_t >( TEnum::COUNT );
+};
+
+/**
+ * @brief Whether EnumTraits< TEnum > provides a count, either from a sentinel or a specialization
+ */
+template < typename TEnum, typename Enable = void >
+struct HasEnumTraits : std::false_type
+{
+};
+
+template < typename TEnum >
+struct HasEnumTraits< TEnum, typename detail::MakeVoid< decltype( EnumTraits< TEnum >::count ) >::type > : std::true_type
+{
+};
+
+/**
+ * @brief Position of an enum value in its [0, count) range
+ */
+template < typename TEnum >
+constexpr std::size_t enumIndex( TEnum value )
+{
+  return static_cast< std::size_t >( value );
+}
+
+/**
+ * @brief Smallest unsigned integer type able to hold MaxValue
+ */
+template < std::size_t MaxValue >
+struct SmallestUnsigned
+{
+  using type = typename std::conditional<
+      MaxValue <= UINT8_MAX,
+      std::uint8_t,
+      typename std::conditional< MaxValue <= UINT16_MAX,
+                                 std::uint16_t,
+                                 typename std::conditional< MaxValue <= UINT32_MAX, std::uint32_t, std::uint64_t >::type >::type >::type;
+};
+
+}  // namespace fsm
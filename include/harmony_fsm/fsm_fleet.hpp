@@ -0,0 +1,682 @@
+/**
+ * @file fsm_fleet.hpp
+ * @brief Harmony FSM struct-of-arrays stepping of many machines sharing one table
+ * @date 2026-10-16
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#if defined( __AVX512F__ ) || defined( __AVX2__ )
+#include <immintrin.h>
+#endif
+
+#include "dense_transition_table.hpp"
+#include "fsm_shared_table.hpp"
+#include "fsm_thread_pool.hpp"
+
+namespace fsm
+{
+static constexpr std::size_t CacheLineSize = 64;
+
+/**
+ * @brief Allocator starting every allocation on a cache line, so that ranges split on cache line multiples never
+ * share a line between threads
+ */
+template < typename T >
+struct CacheAlignedAllocator
+{
+  using value_type = T;
+
+  CacheAlignedAllocator() = default;
+
+  template < typename U >
+  CacheAlignedAllocator( const CacheAlignedAllocator< U >& )
+  {
+  }
+
+  T* allocate( std::size_t count )
+  {
+    // over allocate, keep the raw pointer just in front of the aligned block
+    char* raw     = static_cast< char* >( ::operator new( count * sizeof( T ) + CacheLineSize + sizeof( void* ) ) );
+    char* aligned = raw + sizeof( void* );
+    aligned += ( CacheLineSize - reinterpret_cast< std::uintptr_t >( aligned ) % CacheLineSize ) % CacheLineSize;
+    reinterpret_cast< void** >( aligned )[-1] = raw;
+    return reinterpret_cast< T* >( aligned );
+  }
+
+  void deallocate( T* ptr, std::size_t )
+  {
+    ::operator delete( reinterpret_cast< void** >( ptr )[-1] );
+  }
+
+  template < typename U >
+  bool operator==( const CacheAlignedAllocator< U >& ) const
+  {
+    return true;
+  }
+
+  template < typename U >
+  bool operator!=( const CacheAlignedAllocator< U >& ) const
+  {
+    return false;
+  }
+};
+
+// validity bitmask of a fleet step, bit i of word i / 64
+using FleetMask = std::vector< std::uint64_t, CacheAlignedAllocator< std::uint64_t > >;
+
+/**
+ * @brief Work and wall time of a fleet step
+ */
+struct FleetStepStats
+{
+  std::size_t Events;
+  std::size_t Chunks;
+  double      Seconds;
+  double      EventsPerSecond;
+};
+
+/**
+ * @brief A single event addressed to one machine of a fleet
+ */
+template < typename TEvent >
+struct FleetEvent
+{
+  std::size_t Instance;
+  TEvent      Trigger;
+};
+
+/**
+ * @class FiniteStateMachineFleet
+ * @brief A population of machines running the same rules, stored as one contiguous array of states packed to the
+ * smallest integer type that fits TState. Events are applied in bulk through a DenseTransitionTable, per-event
+ * validity comes back as a bitmask (bit i of word i / 64). Invalid events leave the machine in its state, as with
+ * FiniteStateMachine::doEvent.
+ *
+ * Per-instance event arrays are stepped with gathers when built with AVX-512F or AVX2 enabled, scalar otherwise.
+ *
+ * @tparam TEvent Event type, needs a COUNT sentinel or an EnumTraits specialization
+ * @tparam TState State type, needs a COUNT sentinel or an EnumTraits specialization
+ */
+template < typename TEvent, typename TState >
+class FiniteStateMachineFleet
+{
+ public:
+  using TransitionTable = DenseTransitionTable< TEvent, TState >;
+
+  // packed storage type of a single machine state
+  using state_type = typename TransitionTable::code_type;
+
+  /**
+   * @brief Construct a new Finite State Machine Fleet object
+   *
+   * @param fsm_table Valid transition table
+   * @param size Number of machines
+   * @param init_state Initial state of every machine
+   */
+  FiniteStateMachineFleet( const std::vector< EventTableEntry< TEvent, TState > >& fsm_table, std::size_t size, TState init_state )
+    : FiniteStateMachineFleet( std::make_shared< const TransitionTable >( fsm_table ), size, init_state )
+  {
+  }
+
+  /**
+   * @brief Construct a new Finite State Machine Fleet object on a shared table
+   *
+   * @param table Immutable transition table, refcounted or borrowed
+   * @param size Number of machines
+   * @param init_state Initial state of every machine
+   * @throw std::out_of_range if init_state lies outside the TState enum range
+   */
+  FiniteStateMachineFleet( std::shared_ptr< const TransitionTable > table, std::size_t size, TState init_state )
+    : table_( std::move( table ) )
+    , wide_codes_( TransitionTable::StateCount * TransitionTable::EventCount )
+    , states_( size, static_cast< state_type >( enumIndex( init_state ) ) )
+  {
+    if ( !TransitionTable::isStateInRange( init_state ) )
+    {
+      throw std::out_of_range( "initial state outside of the TState enum range" );
+    }
+
+    // 32 bit copy of the table with -1 for undefined transitions, the element size gathers operate on
+    for ( std::size_t i = 0; i < wide_codes_.size(); i++ )
+    {
+      const state_type code = table_->data()[i];
+      wide_codes_[i]        = code == TransitionTable::InvalidCode ? -1 : static_cast< std::int32_t >( code );
+    }
+  }
+
+  std::size_t size() const
+  {
+    return states_.size();
+  }
+
+  /**
+   * @brief Number of 64 bit words in a validity mask for count events
+   */
+  static std::size_t maskWords( std::size_t count )
+  {
+    return ( count + 63 ) / 64;
+  }
+
+  /**
+   * @throw std::out_of_range if instance is past size()
+   */
+  TState getState( std::size_t instance ) const
+  {
+    checkInstance( instance );
+    return static_cast< TState >( states_[instance] );
+  }
+
+  /**
+   * @throw std::out_of_range if instance is past size() or state is outside of the TState enum range
+   */
+  void setState( std::size_t instance, TState state )
+  {
+    checkInstance( instance );
+    if ( !TransitionTable::isStateInRange( state ) )
+    {
+      throw std::out_of_range( "state outside of the TState enum range" );
+    }
+
+    states_[instance] = static_cast< state_type >( enumIndex( state ) );
+  }
+
+  /**
+   * @brief Packed states of every machine
+   */
+  const state_type* data() const
+  {
+    return states_.data();
+  }
+
+  const TransitionTable& getTransitionTable() const
+  {
+    return *table_;
+  }
+
+  /**
+   * @brief Applies events[i] to machine i for every machine in one pass
+   *
+   * @param events size() events
+   * @param valid_mask maskWords( size() ) words, bit i set when events[i] was a valid transition
+   */
+  void doEvents( const TEvent* events, std::uint64_t* valid_mask )
+  {
+    doEvents( events, valid_mask, 0, states_.size() );
+  }
+
+  /**
+   * @brief Applies events[i] to machine i for every machine in one pass
+   *
+   * @param events size() events
+   * @return FleetMask bit i set when events[i] was a valid transition
+   */
+  FleetMask doEvents( const std::vector< TEvent >& events )
+  {
+    if ( events.size() != states_.size() )
+    {
+      throw std::invalid_argument( "one event per machine is required" );
+    }
+
+    FleetMask valid_mask( maskWords( events.size() ) );
+    doEvents( events.data(), valid_mask.data() );
+    return valid_mask;
+  }
+
+  /**
+   * @brief Applies events[i] to machine i for machines [first, last). Only the mask bits of machines in the range
+   * are written, concurrent calls must use ranges that do not share mask words (multiples of 64 machines).
+   *
+   * @param events size() events, indexed by machine
+   * @param valid_mask maskWords( size() ) words, indexed by machine
+   * @param first First machine
+   * @param last One past the last machine
+   */
+  void doEvents( const TEvent* events, std::uint64_t* valid_mask, std::size_t first, std::size_t last )
+  {
+    std::size_t i = first;
+#if defined( __AVX512F__ ) || defined( __AVX2__ )
+    // gathers start on a lane aligned machine so a block never straddles two mask words
+    const std::size_t aligned = std::min( last, ( first + GatherLanes - 1 ) / GatherLanes * GatherLanes );
+    stepScalar( events, valid_mask, i, aligned );
+    i = stepGather( events, valid_mask, aligned, last );
+#endif
+    stepScalar( events, valid_mask, i, last );
+  }
+
+  /**
+   * @brief Applies a batch of addressed events in order. The same machine may appear several times.
+   *
+   * @param first First event of the batch
+   * @param last One past the last event of the batch
+   * @param valid_mask maskWords( last - first ) words, bit k set when event k of the batch was a valid transition
+   * @throw std::out_of_range if an event addresses a machine past size(), no event is applied then
+   */
+  void doEvents( const FleetEvent< TEvent >* first, const FleetEvent< TEvent >* last, std::uint64_t* valid_mask )
+  {
+    const std::size_t count = static_cast< std::size_t >( last - first );
+    for ( std::size_t k = 0; k < count; k++ )
+    {
+      checkInstance( first[k].Instance );
+    }
+
+    for ( std::size_t w = 0; w < maskWords( count ); w++ )
+    {
+      valid_mask[w] = 0;
+    }
+
+    for ( std::size_t k = 0; k < count; k++ )
+    {
+      if ( k + PrefetchDistance < count )
+      {
+        prefetch( &states_[first[k + PrefetchDistance].Instance] );
+      }
+
+      if ( apply( first[k].Instance, first[k].Trigger ) )
+      {
+        valid_mask[k / 64] |= std::uint64_t( 1 ) << ( k % 64 );
+      }
+    }
+  }
+
+  /**
+   * @brief Applies a batch of addressed events in order. The same machine may appear several times.
+   *
+   * @param batch Events addressed to machines
+   * @return FleetMask bit k set when batch[k] was a valid transition
+   * @throw std::out_of_range if an event addresses a machine past size(), no event is applied then
+   */
+  FleetMask doEvents( const std::vector< FleetEvent< TEvent > >& batch )
+  {
+    FleetMask valid_mask( maskWords( batch.size() ) );
+    doEvents( batch.data(), batch.data() + batch.size(), valid_mask.data() );
+    return valid_mask;
+  }
+
+  /**
+   * @brief Applies events[i] to machine i for every machine, split across a thread pool. Machines are cut into
+   * chunks of ChunkAlignment multiples so that no two threads write the same cache line of states or mask words,
+   * provided events and valid_mask start on a cache line (see FleetMask).
+   *
+   * @param pool Pool to run on, the calling thread helps
+   * @param events size() events
+   * @param valid_mask maskWords( size() ) words, bit i set when events[i] was a valid transition
+   * @return FleetStepStats
+   */
+  FleetStepStats doEvents( WorkStealingThreadPool& pool, const TEvent* events, std::uint64_t* valid_mask )
+  {
+    const auto        start  = std::chrono::steady_clock::now();
+    const std::size_t chunk  = chunkSize( pool.size() );
+    const std::size_t chunks = ( states_.size() + chunk - 1 ) / chunk;
+
+    pool.parallelFor( chunks, [&]( std::size_t c ) {
+      doEvents( events, valid_mask, c * chunk, std::min( states_.size(), ( c + 1 ) * chunk ) );
+    } );
+
+    return makeStats( states_.size(), chunks, start );
+  }
+
+  /**
+   * @brief Applies a batch of addressed events across a thread pool. Events are bucketed by the chunk owning their
+   * machine, keeping batch order within a machine, and uneven buckets are balanced by work stealing.
+   *
+   * @param pool Pool to run on, the calling thread helps
+   * @param first First event of the batch
+   * @param last One past the last event of the batch
+   * @param valid_mask maskWords( last - first ) words, bit k set when event k of the batch was a valid transition
+   * @return FleetStepStats
+   * @throw std::out_of_range if an event addresses a machine past size(), no event is applied then
+   */
+  FleetStepStats doEvents( WorkStealingThreadPool&         pool,
+                           const FleetEvent< TEvent >* first,
+                           const FleetEvent< TEvent >* last,
+                           std::uint64_t*                  valid_mask )
+  {
+    const auto        start  = std::chrono::steady_clock::now();
+    const std::size_t count  = static_cast< std::size_t >( last - first );
+    const std::size_t chunk  = chunkSize( pool.size() );
+    const std::size_t chunks = ( states_.size() + chunk - 1 ) / chunk;
+
+    // counting sort of batch positions by owning chunk
+    std::vector< std::size_t > offsets( chunks + 1, 0 );
+    for ( std::size_t k = 0; k < count; k++ )
+    {
+      checkInstance( first[k].Instance );
+      offsets[first[k].Instance / chunk + 1]++;
+    }
+
+    for ( std::size_t c = 0; c < chunks; c++ )
+    {
+      offsets[c + 1] += offsets[c];
+    }
+
+    // order lists batch positions by chunk, position is its inverse
+    std::vector< std::size_t > order( count );
+    std::vector< std::size_t > position( count );
+    std::vector< std::size_t > cursor( offsets.begin(), offsets.end() - 1 );
+    for ( std::size_t k = 0; k < count; k++ )
+    {
+      const std::size_t j = cursor[first[k].Instance / chunk]++;
+      order[j]            = k;
+      position[k]         = j;
+    }
+
+    // each chunk records its results in bucket order in mask words of its own, starting on a cache line, so no
+    // two threads write the same line
+    const std::size_t          words_per_line = CacheLineSize / sizeof( std::uint64_t );
+    std::vector< std::size_t > local_base( chunks + 1, 0 );
+    for ( std::size_t c = 0; c < chunks; c++ )
+    {
+      const std::size_t words = maskWords( offsets[c + 1] - offsets[c] );
+      local_base[c + 1]       = local_base[c] + ( words + words_per_line - 1 ) / words_per_line * words_per_line;
+    }
+
+    FleetMask local( local_base[chunks] );
+    pool.parallelFor( chunks, [&]( std::size_t c ) {
+      std::uint64_t* bits = local.data() + local_base[c];
+      for ( std::size_t j = offsets[c]; j < offsets[c + 1]; j++ )
+      {
+        const std::size_t k = order[j];
+        if ( apply( first[k].Instance, first[k].Trigger ) )
+        {
+          bits[( j - offsets[c] ) / 64] |= std::uint64_t( 1 ) << ( ( j - offsets[c] ) % 64 );
+        }
+      }
+    } );
+
+    // gather into batch order, a cache line of mask words per task
+    const std::size_t words = maskWords( count );
+    pool.parallelFor( ( words + words_per_line - 1 ) / words_per_line, [&]( std::size_t line ) {
+      for ( std::size_t w = line * words_per_line; w < std::min( words, ( line + 1 ) * words_per_line ); w++ )
+      {
+        std::uint64_t word = 0;
+        for ( std::size_t k = w * 64; k < std::min( count, ( w + 1 ) * 64 ); k++ )
+        {
+          const std::size_t c   = first[k].Instance / chunk;
+          const std::size_t bit = position[k] - offsets[c];
+          word |= ( ( local[local_base[c] + bit / 64] >> ( bit % 64 ) ) & 1 ) << ( k % 64 );
+        }
+        valid_mask[w] = word;
+      }
+    } );
+
+    return makeStats( count, chunks, start );
+  }
+
+  /**
+   * @brief Machines per parallel chunk for a pool of the given size, a multiple of ChunkAlignment
+   */
+  std::size_t chunkSize( std::size_t threads ) const
+  {
+    const std::size_t target = states_.size() / ( std::max< std::size_t >( threads, 1 ) * ChunksPerThread );
+    const std::size_t chunk  = ( target + ChunkAlignment - 1 ) / ChunkAlignment * ChunkAlignment;
+    return std::max( chunk, MinChunkSize );
+  }
+
+  // machines per alignment unit: a whole cache line of mask words, which also covers whole cache lines of states
+  static constexpr std::size_t ChunkAlignment = CacheLineSize / sizeof( std::uint64_t ) * 64;
+
+  /**
+   * @brief Applies a single event to a single machine
+   *
+   * @return true if the state change was executed successfully
+   * @throw std::out_of_range if instance is past size()
+   */
+  bool doEvent( std::size_t instance, const TEvent& trigger )
+  {
+    checkInstance( instance );
+    return apply( instance, trigger );
+  }
+
+ protected:
+  static constexpr std::size_t PrefetchDistance = 8;
+  static constexpr std::size_t ChunksPerThread  = 8;
+  static constexpr std::size_t MinChunkSize     = ChunkAlignment * 8;
+
+  static FleetStepStats makeStats( std::size_t events, std::size_t chunks, std::chrono::steady_clock::time_point start )
+  {
+    const double seconds = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+    return FleetStepStats{ events, chunks, seconds, seconds > 0 ? events / seconds : 0 };
+  }
+
+  void checkInstance( std::size_t instance ) const
+  {
+    if ( instance >= states_.size() )
+    {
+      throw std::out_of_range( "fleet event addresses a machine outside of the fleet" );
+    }
+  }
+
+  // unchecked, callers validate the instance
+  bool apply( std::size_t instance, const TEvent& trigger )
+  {
+    const std::int32_t res = lookup( states_[instance], enumIndex( trigger ) );
+    if ( res < 0 )
+    {
+      return false;
+    }
+
+    states_[instance] = static_cast< state_type >( res );
+    return true;
+  }
+
+  std::int32_t lookup( state_type state, std::size_t event_idx ) const
+  {
+    return event_idx < TransitionTable::EventCount ? wide_codes_[state * TransitionTable::EventCount + event_idx] : -1;
+  }
+
+  static void prefetch( const void* address )
+  {
+#if defined( __GNUC__ )
+    __builtin_prefetch( address, 1 );
+#else
+    (void)address;
+#endif
+  }
+
+  void stepScalar( const TEvent* events, std::uint64_t* valid_mask, std::size_t first, std::size_t last )
+  {
+    std::uint64_t word = 0;
+    for ( std::size_t i = first; i < last; i++ )
+    {
+      const state_type   state = states_[i];
+      const std::int32_t res   = lookup( state, enumIndex( events[i] ) );
+      const bool         valid = res >= 0;
+
+      states_[i] = valid ? static_cast< state_type >( res ) : state;
+      word |= std::uint64_t( valid ) << ( i % 64 );
+
+      if ( i % 64 == 63 || i + 1 == last )
+      {
+        setMaskBits( valid_mask, i / 64, word, rangeBits( first, last, i / 64 ) );
+        word = 0;
+      }
+    }
+  }
+
+  // bits of mask word w covered by machines [first, last)
+  static std::uint64_t rangeBits( std::size_t first, std::size_t last, std::size_t w )
+  {
+    const std::size_t   lo    = first > w * 64 ? first - w * 64 : 0;
+    const std::size_t   hi    = last < ( w + 1 ) * 64 ? last - w * 64 : 64;
+    const std::uint64_t upper = hi == 64 ? ~std::uint64_t( 0 ) : ( std::uint64_t( 1 ) << hi ) - 1;
+    return upper & ~( ( std::uint64_t( 1 ) << lo ) - 1 );
+  }
+
+  // replaces the covered bits of mask word w
+  static void setMaskBits( std::uint64_t* valid_mask, std::size_t w, std::uint64_t bits, std::uint64_t covered )
+  {
+    valid_mask[w] = ( valid_mask[w] & ~covered ) | bits;
+  }
+
+#if defined( __AVX512F__ ) || defined( __AVX2__ )
+  // widening loads of 8/16 packed values to 32 bit lanes, only for element sizes the gathers can use
+  template < typename T >
+  static constexpr bool isGatherable()
+  {
+    return sizeof( T ) == 1 || sizeof( T ) == 2 || sizeof( T ) == 4;
+  }
+
+  // writes the lanes bits of machines [i, i + lanes), i is a multiple of lanes
+  static void setLaneBits( std::uint64_t* valid_mask, std::size_t i, std::uint64_t bits, std::size_t lanes )
+  {
+    const std::size_t shift = i % 64;
+    setMaskBits( valid_mask, i / 64, bits << shift, ( ( std::uint64_t( 1 ) << lanes ) - 1 ) << shift );
+  }
+#endif
+
+#if defined( __AVX512F__ )
+  static constexpr std::size_t GatherLanes = 16;
+
+  template < typename T >
+  static __m512i load16( const T* ptr )
+  {
+    switch ( sizeof( T ) )
+    {
+      case 1:
+        return _mm512_cvtepu8_epi32( _mm_loadu_si128( reinterpret_cast< const __m128i* >( ptr ) ) );
+      case 2:
+        return _mm512_cvtepu16_epi32( _mm256_loadu_si256( reinterpret_cast< const __m256i* >( ptr ) ) );
+      default:
+        return _mm512_loadu_si512( ptr );
+    }
+  }
+
+  std::size_t stepGather( const TEvent* events, std::uint64_t* valid_mask, std::size_t first, std::size_t last )
+  {
+    if ( !isGatherable< TEvent >() || !isGatherable< state_type >() )
+    {
+      return first;
+    }
+
+    const __m512i event_count = _mm512_set1_epi32( static_cast< int >( TransitionTable::EventCount ) );
+    const __m512i invalid     = _mm512_set1_epi32( -1 );
+    const __m512i zero        = _mm512_setzero_si512();
+    alignas( 64 ) std::int32_t next[16];
+
+    std::size_t i = first;
+    for ( ; i + 16 <= last; i += 16 )
+    {
+      const __m512i   state    = load16( &states_[i] );
+      const __m512i   event    = load16( &events[i] );
+      const __mmask16 in_range = _mm512_cmplt_epu32_mask( event, event_count );
+      const __m512i   index    = _mm512_add_epi32( _mm512_mullo_epi32( state, event_count ), event );
+      const __m512i   res      = _mm512_mask_i32gather_epi32( invalid, in_range, index, wide_codes_.data(), 4 );
+      const __mmask16 valid    = _mm512_cmpge_epi32_mask( res, zero );
+
+      _mm512_store_si512( next, _mm512_mask_blend_epi32( valid, state, res ) );
+      for ( std::size_t lane = 0; lane < 16; lane++ )
+      {
+        states_[i + lane] = static_cast< state_type >( next[lane] );
+      }
+
+      setLaneBits( valid_mask, i, static_cast< std::uint64_t >( valid ), 16 );
+    }
+
+    return i;
+  }
+#elif defined( __AVX2__ )
+  static constexpr std::size_t GatherLanes = 8;
+
+  template < typename T >
+  static __m256i load8( const T* ptr )
+  {
+    switch ( sizeof( T ) )
+    {
+      case 1:
+        return _mm256_cvtepu8_epi32( _mm_loadl_epi64( reinterpret_cast< const __m128i* >( ptr ) ) );
+      case 2:
+        return _mm256_cvtepu16_epi32( _mm_loadu_si128( reinterpret_cast< const __m128i* >( ptr ) ) );
+      default:
+        return _mm256_loadu_si256( reinterpret_cast< const __m256i* >( ptr ) );
+    }
+  }
+
+  std::size_t stepGather( const TEvent* events, std::uint64_t* valid_mask, std::size_t first, std::size_t last )
+  {
+    if ( !isGatherable< TEvent >() || !isGatherable< state_type >() )
+    {
+      return first;
+    }
+
+    const __m256i event_count = _mm256_set1_epi32( static_cast< int >( TransitionTable::EventCount ) );
+    const __m256i invalid     = _mm256_set1_epi32( -1 );
+    alignas( 32 ) std::int32_t next[8];
+
+    std::size_t i = first;
+    for ( ; i + 8 <= last; i += 8 )
+    {
+      const __m256i state    = load8( &states_[i] );
+      const __m256i event    = load8( &events[i] );
+      // 0 <= event < EventCount, as signed compares
+      const __m256i in_range = _mm256_andnot_si256( _mm256_cmpgt_epi32( _mm256_setzero_si256(), event ), _mm256_cmpgt_epi32( event_count, event ) );
+      const __m256i index    = _mm256_add_epi32( _mm256_mullo_epi32( state, event_count ), event );
+      const __m256i res      = _mm256_mask_i32gather_epi32( invalid, wide_codes_.data(), index, in_range, 4 );
+      const __m256i valid    = _mm256_cmpgt_epi32( res, invalid );
+
+      _mm256_store_si256( reinterpret_cast< __m256i* >( next ), _mm256_blendv_epi8( state, res, valid ) );
+      for ( std::size_t lane = 0; lane < 8; lane++ )
+      {
+        states_[i + lane] = static_cast< state_type >( next[lane] );
+      }
+
+      setLaneBits( valid_mask, i, static_cast< std::uint64_t >( _mm256_movemask_ps( _mm256_castsi256_ps( valid ) ) ), 8 );
+    }
+
+    return i;
+  }
+#endif
+
+  std::shared_ptr< const TransitionTable >                       table_;
+  std::vector< std::int32_t >                                    wide_codes_;
+  std::vector< state_type, CacheAlignedAllocator< state_type > > states_;
+};
+
+template < typename TEvent, typename TState >
+constexpr std::size_t FiniteStateMachineFleet< TEvent, TState >::PrefetchDistance;
+
+template < typename TEvent, typename TState >
+constexpr std::size_t FiniteStateMachineFleet< TEvent, TState >::ChunksPerThread;
+
+template < typename TEvent, typename TState >
+constexpr std::size_t FiniteStateMachineFleet< TEvent, TState >::MinChunkSize;
+
+template < typename TEvent, typename TState >
+constexpr std::size_t FiniteStateMachineFleet< TEvent, TState >::ChunkAlignment;
+
+}  // namespace fsm
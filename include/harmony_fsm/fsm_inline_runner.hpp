@@ -0,0 +1,219 @@
+/**
+ * @file fsm_inline_runner.hpp
+ * @brief Harmony FSM Runner executing on the calling thread
+ * @date 2026-10-16
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+
+#include "fsm_runner_base.hpp"
+
+namespace fsm
+{
+/**
+ * @brief Runs a generic Finite State Machine without threads. doEventAndExecute and updateFSM run the
+ * pre-execution function, the state function and the completion handler on the calling thread before returning.
+ * Commands queued from within the handlers, typically the next doEventAndExecute from the completion handler, are
+ * run by the same loop once the current step returns instead of recursing. Timeouts are checked at each step
+ * boundary: a state function that took longer than the timeout is reported to the timeout handler after it
+ * returns. Like the threaded runner, an exception from the handlers stops execution and is passed to the
+ * exception handler. Set the functions and handlers before calling start.
+ */
+template < typename TEvent, typename TState, typename TCommandParameter, typename TResult, typename TClock >
+class InlineFiniteStateMachineRunner : public FiniteStateMachineRunnerBase< TEvent, TState, TCommandParameter, TResult, TClock >
+{
+  using Base          = FiniteStateMachineRunnerBase< TEvent, TState, TCommandParameter, TResult, TClock >;
+  using QueuedCommand = typename Base::QueuedCommand;
+
+ public:
+  /**
+   * @brief Construct a new Inline Finite State Machine Runner object, single function for execution by default
+   *
+   * @param fsm_table Valid transition table
+   * @param init_state Initial state
+   * @param init_result The initial result to process when kicked by the completion_handler at startup
+   * @param exec_fun Single function through which all states execute
+   * @param completion_handler Function through which execution results are processed. Kick into new states here
+   * @param pre_exec_fun Function to run before executing any state function
+   * @param timeout_handler If an execution function takes longer that timeout (see setTimeout), execute this function
+   * @param exception_handler If an exception is thrown during an execution function, it will propogate to this handler
+   */
+  InlineFiniteStateMachineRunner( std::vector< EventTableEntry< TEvent, TState > >     fsm_table,
+                                  TState                                               init_state,
+                                  TResult                                              init_result,
+                                  std::function< TResult( const TCommandParameter* ) > exec_fun           = nullptr,
+                                  std::function< void( const TResult& ) >              completion_handler = nullptr,
+                                  std::function< void( const TCommandParameter* ) >    pre_exec_fun       = nullptr,
+                                  std::function< void( double ) >                      timeout_handler    = nullptr,
+                                  std::function< void( const std::exception& ) >       exception_handler  = nullptr )
+    : Base( fsm_table, init_state, init_result, exec_fun, completion_handler, pre_exec_fun, timeout_handler, exception_handler )
+  {
+  }
+
+  /**
+   * @brief Construct a new Inline Finite State Machine Runner object, utilizes a map of states to functions
+   *
+   * @param fsm_table Valid transition table
+   * @param init_state Initial state
+   * @param init_result The initial result to process when kicked by the completion_handler
+   * @param exec_fun_map A map of TState vs functions to execute for each state
+   * @param completion_handler Function through which execution results are processed. Kick into new states here
+   * @param pre_exec_fun Function to run before executing any state function
+   * @param timeout_handler If an execution function takes longer that timeout (see setTimeout), execute this function
+   * @param exception_handler If an exception is thrown during an execution function, it will propogate to this handler
+   */
+  InlineFiniteStateMachineRunner( std::vector< EventTableEntry< TEvent, TState > >                         fsm_table,
+                                  TState                                                                   init_state,
+                                  TResult                                                                  init_result,
+                                  std::map< TState, std::function< TResult( const TCommandParameter* ) > > exec_fun_map,
+                                  std::function< void( const TResult& ) >                                  completion_handler = nullptr,
+                                  std::function< void( const TCommandParameter* ) >                        pre_exec_fun       = nullptr,
+                                  std::function< void( double ) >                                          timeout_handler    = nullptr,
+                                  std::function< void( const std::exception& ) >                           exception_handler  = nullptr )
+    : Base( fsm_table, init_state, init_result, exec_fun_map, completion_handler, pre_exec_fun, timeout_handler, exception_handler )
+  {
+  }
+
+  virtual ~InlineFiniteStateMachineRunner()
+  {
+    stop();
+  }
+
+  /**
+   * @brief Hands the initial result to the completion handler on the calling thread, along with any command it
+   * queues
+   */
+  void start() override
+  {
+    this->shutdown_desired_ = false;
+    failed_                 = false;
+    deliver_initial_        = true;
+    this->commands_->open();
+    drain();
+  }
+
+  /**
+   * @brief Issues stop request, commands still queued are not run
+   */
+  void stop() override
+  {
+    this->shutdown_desired_ = true;
+    this->commands_->close();
+  }
+
+ protected:
+  void notifyCommand() override
+  {
+    drain();
+  }
+
+ private:
+  bool halted() const
+  {
+    return this->shutdown_desired_ || failed_;
+  }
+
+  /**
+   * @brief Runs queued commands until the queue is empty. A call made while another thread or an outer call on
+   * this thread is draining returns at once, the command it queued is run by that drain.
+   */
+  void drain()
+  {
+    while ( !draining_.exchange( true ) )
+    {
+      try
+      {
+        if ( deliver_initial_.exchange( false ) )
+        {
+          complete( this->init_result_ );
+        }
+
+        QueuedCommand queued;
+        while ( !halted() && this->popCommand( queued ) )
+        {
+          this->executeCommand( queued, TClock::sinceEpoch(), [&]( TResult&& res ) {
+            if ( timed() )
+            {
+              checkStep( TClock::sinceEpoch() );
+            }
+            complete( res );
+          } );
+        }
+      }
+      catch ( std::exception& ex )
+      {
+        failed_ = true;
+        this->handleException( ex );
+      }
+
+      // a producer that saw draining_ set before this store relies on the recheck of the loop
+      draining_.store( false );
+      std::atomic_thread_fence( std::memory_order_seq_cst );
+      if ( halted() || !this->hasPendingCommand() )
+      {
+        return;
+      }
+    }
+  }
+
+  bool timed() const
+  {
+    return this->timeout_handler_fun_ && this->timeout_ != std::chrono::nanoseconds::max();
+  }
+
+  // the state function has returned at response, report it if it took longer than the timeout
+  void checkStep( std::chrono::nanoseconds response )
+  {
+    const std::chrono::nanoseconds step_start = this->cycle_time_.load( std::memory_order_relaxed );
+    if ( ( response - step_start ) > this->timeout_ )
+    {
+      this->timeout_handler_fun_( toSeconds( step_start ) );
+    }
+  }
+
+  void complete( const TResult& res )
+  {
+    if ( this->completion_handler_fun_ )
+    {
+      this->completion_handler_fun_( res );
+    }
+  }
+
+  std::atomic< bool > draining_{ false };
+  std::atomic< bool > deliver_initial_{ false };
+  std::atomic< bool > failed_{ false };
+};
+
+}  // namespace fsm
@@ -0,0 +1,246 @@
+/**
+ * @file fsm_manual_runner.hpp
+ * @brief Harmony FSM Runner advanced by explicit ticks
+ * @date 2026-10-16
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <map>
+
+#include "fsm_runner_base.hpp"
+
+namespace fsm
+{
+/**
+ * @brief Runs a generic Finite State Machine without threads or sleeping, advanced by explicit tick calls, e.g.
+ * from a simulator running faster than real time. Commands queued by updateFSM and doEventAndExecute wait for the
+ * next tick. A tick delivers the initial result after start, runs up to max_steps queued commands with their
+ * pre-execution function, state function and completion handler, then checks the timeout against the time of
+ * the tick. A command queued by a completion handler therefore runs on the following step, as in the threaded
+ * runner. Runners do not share state, so a batch of them can be ticked in parallel, e.g. with
+ * WorkStealingThreadPool::parallelFor. Like the threaded runner, an exception from the handlers stops execution and
+ * is passed to the exception handler. Set the functions and handlers before calling start.
+ */
+template < typename TEvent, typename TState, typename TCommandParameter, typename TResult, typename TClock >
+class ManualFiniteStateMachineRunner : public FiniteStateMachineRunnerBase< TEvent, TState, TCommandParameter, TResult, TClock >
+{
+  using Base          = FiniteStateMachineRunnerBase< TEvent, TState, TCommandParameter, TResult, TClock >;
+  using QueuedCommand = typename Base::QueuedCommand;
+
+ public:
+  /**
+   * @brief Construct a new Manual Finite State Machine Runner object, single function for execution by default
+   *
+   * @param fsm_table Valid transition table
+   * @param init_state Initial state
+   * @param init_result The initial result to process when kicked by the completion_handler at startup
+   * @param exec_fun Single function through which all states execute
+   * @param completion_handler Function through which execution results are processed. Kick into new states here
+   * @param pre_exec_fun Function to run before executing any state function
+   * @param timeout_handler If no state function responded for longer than timeout (see setTimeout), execute this function
+   * @param exception_handler If an exception is thrown during an execution function, it will propogate to this handler
+   */
+  ManualFiniteStateMachineRunner( std::vector< EventTableEntry< TEvent, TState > >     fsm_table,
+                                  TState                                               init_state,
+                                  TResult                                              init_result,
+                                  std::function< TResult( const TCommandParameter* ) > exec_fun           = nullptr,
+                                  std::function< void( const TResult& ) >              completion_handler = nullptr,
+                                  std::function< void( const TCommandParameter* ) >    pre_exec_fun       = nullptr,
+                                  std::function< void( double ) >                      timeout_handler    = nullptr,
+                                  std::function< void( const std::exception& ) >       exception_handler  = nullptr )
+    : Base( fsm_table, init_state, init_result, exec_fun, completion_handler, pre_exec_fun, timeout_handler, exception_handler )
+  {
+  }
+
+  /**
+   * @brief Construct a new Manual Finite State Machine Runner object, utilizes a map of states to functions
+   *
+   * @param fsm_table Valid transition table
+   * @param init_state Initial state
+   * @param init_result The initial result to process when kicked by the completion_handler
+   * @param exec_fun_map A map of TState vs functions to execute for each state
+   * @param completion_handler Function through which execution results are processed. Kick into new states here
+   * @param pre_exec_fun Function to run before executing any state function
+   * @param timeout_handler If no state function responded for longer than timeout (see setTimeout), execute this function
+   * @param exception_handler If an exception is thrown during an execution function, it will propogate to this handler
+   */
+  ManualFiniteStateMachineRunner( std::vector< EventTableEntry< TEvent, TState > >                         fsm_table,
+                                  TState                                                                   init_state,
+                                  TResult                                                                  init_result,
+                                  std::map< TState, std::function< TResult( const TCommandParameter* ) > > exec_fun_map,
+                                  std::function< void( const TResult& ) >                                  completion_handler = nullptr,
+                                  std::function< void( const TCommandParameter* ) >                        pre_exec_fun       = nullptr,
+                                  std::function< void( double ) >                                          timeout_handler    = nullptr,
+                                  std::function< void( const std::exception& ) >                           exception_handler  = nullptr )
+    : Base( fsm_table, init_state, init_result, exec_fun_map, completion_handler, pre_exec_fun, timeout_handler, exception_handler )
+  {
+  }
+
+  /**
+   * @brief Starts at the current time of TClock, the initial result is delivered by the next tick
+   */
+  void start() override
+  {
+    start( TClock::sinceEpoch() );
+  }
+
+  /**
+   * @brief Starts at the given time, the initial result is delivered by the next tick
+   *
+   * @param now Start time in seconds, the timeout is measured from here
+   */
+  void start( double now )
+  {
+    start( toNanoseconds( now ) );
+  }
+
+  /**
+   * @brief Starts at the given time since the TClock epoch, see start( double )
+   */
+  void start( std::chrono::nanoseconds now )
+  {
+    this->shutdown_desired_ = false;
+    failed_                 = false;
+    deliver_initial_        = true;
+    last_response_          = now;
+    this->commands_->open();
+  }
+
+  /**
+   * @brief Issues stop request, commands still queued are not run
+   */
+  void stop() override
+  {
+    this->shutdown_desired_ = true;
+    this->commands_->close();
+  }
+
+  /**
+   * @brief Advances the runner to the current time of TClock
+   *
+   * @param max_steps Most queued commands to run in this tick
+   * @return Number of state functions run
+   */
+  std::size_t tick( std::size_t max_steps = 1 )
+  {
+    return tick( TClock::sinceEpoch(), max_steps );
+  }
+
+  /**
+   * @brief Advances the runner to the given time: delivers the initial result after start, runs up to max_steps
+   * queued commands and invokes the timeout handler if no state function responded within the timeout of now.
+   * Time is only taken from the ticks, so the result of a sequence of ticks does not depend on wall time.
+   *
+   * @param now Time of this tick in seconds, must not decrease between ticks
+   * @param max_steps Most queued commands to run in this tick
+   * @return Number of state functions run
+   */
+  std::size_t tick( double now, std::size_t max_steps = 1 )
+  {
+    return tick( toNanoseconds( now ), max_steps );
+  }
+
+  /**
+   * @brief Advances the runner to the given time since the TClock epoch, see tick( double, std::size_t )
+   */
+  std::size_t tick( std::chrono::nanoseconds now, std::size_t max_steps = 1 )
+  {
+    std::size_t executed = 0;
+    if ( halted() )
+    {
+      return executed;
+    }
+
+    try
+    {
+      if ( deliver_initial_ )
+      {
+        deliver_initial_ = false;
+        complete( this->init_result_ );
+      }
+
+      QueuedCommand queued;
+      while ( !halted() && executed < max_steps && this->popCommand( queued ) )
+      {
+        if ( this->executeCommand( queued, now, [&]( TResult&& res ) {
+               last_response_ = now;
+               complete( res );
+             } ) )
+        {
+          executed++;
+        }
+      }
+
+      if ( !halted() && this->timeout_handler_fun_ && ( now - last_response_ ) > this->timeout_ )
+      {
+        this->timeout_handler_fun_( toSeconds( last_response_ ) );
+      }
+    }
+    catch ( std::exception& ex )
+    {
+      failed_ = true;
+      this->handleException( ex );
+    }
+
+    return executed;
+  }
+
+ protected:
+  // commands wait for the next tick
+  void notifyCommand() override
+  {
+  }
+
+ private:
+  bool halted() const
+  {
+    return this->shutdown_desired_ || failed_;
+  }
+
+  void complete( const TResult& res )
+  {
+    if ( this->completion_handler_fun_ )
+    {
+      this->completion_handler_fun_( res );
+    }
+  }
+
+  bool                     deliver_initial_ = false;
+  std::chrono::nanoseconds last_response_{ 0 };
+
+  std::atomic< bool > failed_{ false };
+};
+
+}  // namespace fsm
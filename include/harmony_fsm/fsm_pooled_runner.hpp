@@ -0,0 +1,301 @@
+/**
+ * @file fsm_pooled_runner.hpp
+ * @brief Finite State Machine runners scheduled as tasks on a shared thread pool
+ * @date 2026-10-16
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <mutex>
+
+#include "fsm_runner_base.hpp"
+#include "fsm_thread_pool.hpp"
+
+namespace fsm
+{
+/**
+ * @class RunnerExecutor
+ * @brief Shared home of many PooledFiniteStateMachineRunner objects: a work-stealing thread pool that runs their
+ * state functions and handlers. Their timeouts are supervised by the shared TimeoutSupervisor. Must outlive the
+ * runners using it.
+ */
+class RunnerExecutor
+{
+ public:
+  /**
+   * @brief Construct a new Runner Executor object
+   *
+   * @param thread_count Number of pool threads, one per core by default
+   * @param timeout_frequency Frequency at which a timeout handler repeats while its runner stays unresponsive
+   * @throw std::invalid_argument if timeout_frequency is not positive
+   */
+  explicit RunnerExecutor( std::size_t thread_count = WorkStealingThreadPool::defaultThreadCount(), double timeout_frequency = 10 )
+    : pool_( thread_count )
+    , timeout_repeat_( timeoutRepeatPeriod( timeout_frequency ) )
+  {
+  }
+
+  RunnerExecutor( const RunnerExecutor& ) = delete;
+  void operator=( const RunnerExecutor& ) = delete;
+
+  WorkStealingThreadPool& pool()
+  {
+    return pool_;
+  }
+
+  /**
+   * @brief Time between timeout handler calls while a runner stays unresponsive
+   */
+  std::chrono::nanoseconds timeoutRepeat() const
+  {
+    return timeout_repeat_;
+  }
+
+ private:
+  WorkStealingThreadPool   pool_;
+  std::chrono::nanoseconds timeout_repeat_;
+};
+
+/**
+ * @brief Runs a generic Finite State Machine as lightweight tasks on the thread pool of a RunnerExecutor instead of
+ * dedicated threads. A runner has at most one task queued or running, which drains its commands in order, so its
+ * state functions and completion handler never run concurrently. The completion handler runs on the pool right
+ * after the state function, unpaced: unlike the threaded runner there is no frequency, and a polled state must be
+ * re-kicked from outside the pool, e.g. by a rate, rather than from the completion handler. Timeouts are supervised by the shared TimeoutSupervisor. Like the threaded runner, an
+ * exception from the handlers stops execution and is passed to the exception handler.
+ * Set the functions and handlers before calling start.
+ */
+template < typename TEvent, typename TState, typename TCommandParameter, typename TResult, typename TClock >
+class PooledFiniteStateMachineRunner : public FiniteStateMachineRunnerBase< TEvent, TState, TCommandParameter, TResult, TClock >
+{
+  using Base          = FiniteStateMachineRunnerBase< TEvent, TState, TCommandParameter, TResult, TClock >;
+  using QueuedCommand = typename Base::QueuedCommand;
+
+ public:
+  // commands run by one task before it yields its pool thread to other runners
+  static constexpr std::size_t CommandsPerTask = 16;
+
+  /**
+   * @brief Construct a new Pooled Finite State Machine Runner object, single function for execution by default
+   *
+   * @param executor Thread pool shared between runners
+   * @param fsm_table Valid transition table
+   * @param init_state Initial state
+   * @param init_result The initial result to process when kicked by the completion_handler at startup
+   * @param exec_fun Single function through which all states execute
+   * @param completion_handler Function through which execution results are processed. Kick into new states here
+   * @param pre_exec_fun Function to run before executing any state function
+   * @param timeout_handler If an execution function takes longer that timeout (see setTimeout), execute this function
+   * @param exception_handler If an exception is thrown during an execution function, it will propogate to this handler
+   */
+  PooledFiniteStateMachineRunner( RunnerExecutor&                                      executor,
+                                  std::vector< EventTableEntry< TEvent, TState > >     fsm_table,
+                                  TState                                               init_state,
+                                  TResult                                              init_result,
+                                  std::function< TResult( const TCommandParameter* ) > exec_fun           = nullptr,
+                                  std::function< void( const TResult& ) >              completion_handler = nullptr,
+                                  std::function< void( const TCommandParameter* ) >    pre_exec_fun       = nullptr,
+                                  std::function< void( double ) >                      timeout_handler    = nullptr,
+                                  std::function< void( const std::exception& ) >       exception_handler  = nullptr )
+    : Base( fsm_table, init_state, init_result, exec_fun, completion_handler, pre_exec_fun, timeout_handler, exception_handler )
+    , executor_( executor )
+  {
+  }
+
+  /**
+   * @brief Construct a new Pooled Finite State Machine Runner object, utilizes a map of states to functions
+   *
+   * @param executor Thread pool shared between runners
+   * @param fsm_table Valid transition table
+   * @param init_state Initial state
+   * @param init_result The initial result to process when kicked by the completion_handler
+   * @param exec_fun_map A map of TState vs functions to execute for each state
+   * @param completion_handler Function through which execution results are processed. Kick into new states here
+   * @param pre_exec_fun Function to run before executing any state function
+   * @param timeout_handler If an execution function takes longer that timeout (see setTimeout), execute this function
+   * @param exception_handler If an exception is thrown during an execution function, it will propogate to this handler
+   */
+  PooledFiniteStateMachineRunner( RunnerExecutor&                                                          executor,
+                                  std::vector< EventTableEntry< TEvent, TState > >                         fsm_table,
+                                  TState                                                                   init_state,
+                                  TResult                                                                  init_result,
+                                  std::map< TState, std::function< TResult( const TCommandParameter* ) > > exec_fun_map,
+                                  std::function< void( const TResult& ) >                                  completion_handler = nullptr,
+                                  std::function< void( const TCommandParameter* ) >                        pre_exec_fun       = nullptr,
+                                  std::function< void( double ) >                                          timeout_handler    = nullptr,
+                                  std::function< void( const std::exception& ) >                           exception_handler  = nullptr )
+    : Base( fsm_table, init_state, init_result, exec_fun_map, completion_handler, pre_exec_fun, timeout_handler, exception_handler )
+    , executor_( executor )
+  {
+  }
+
+  /**
+   * @brief Stops and waits for a queued or running task of this runner to finish
+   */
+  virtual ~PooledFiniteStateMachineRunner()
+  {
+    stop();
+
+    std::unique_lock< std::mutex > lock( idle_mutex_ );
+    idle_.wait( lock, [&]() { return tasks_in_flight_ == 0; } );
+  }
+
+  /**
+   * @brief Starts supervising timeouts and schedules the delivery of the initial result
+   */
+  void start() override
+  {
+    this->shutdown_desired_ = false;
+    failed_                 = false;
+    deliver_initial_        = true;
+    this->commands_->open();
+    this->superviseTimeout( executor_.timeoutRepeat() );
+    schedule();
+  }
+
+  /**
+   * @brief Issues stop request, commands still queued are not run
+   */
+  void stop() override
+  {
+    this->shutdown_desired_ = true;
+    this->commands_->close();
+    this->releaseTimeout();
+  }
+
+ protected:
+  void notifyCommand() override
+  {
+    schedule();
+  }
+
+ private:
+  // at most one task per runner is queued or running
+  void schedule()
+  {
+    if ( !scheduled_.exchange( true ) )
+    {
+      submit();
+    }
+  }
+
+  void submit()
+  {
+    {
+      std::unique_lock< std::mutex > lock( idle_mutex_ );
+      tasks_in_flight_++;
+    }
+    executor_.pool().submit( [this]() { run(); } );
+  }
+
+  bool halted() const
+  {
+    return this->shutdown_desired_ || failed_;
+  }
+
+  /**
+   * @brief Drains up to CommandsPerTask commands, then either requeues itself or releases the runner
+   */
+  void run()
+  {
+    std::size_t executed = 0;
+    try
+    {
+      if ( deliver_initial_.exchange( false ) )
+      {
+        complete( this->init_result_ );
+      }
+
+      QueuedCommand queued;
+      while ( !halted() && executed < CommandsPerTask && this->popCommand( queued ) )
+      {
+        this->executeCommand( queued, TClock::sinceEpoch(), [this]( TResult&& res ) {
+          this->markResponse( TClock::sinceEpoch() );
+          complete( res );
+        } );
+        executed++;
+      }
+    }
+    catch ( std::exception& ex )
+    {
+      failed_ = true;
+      this->handleException( ex );
+    }
+
+    if ( !halted() && executed == CommandsPerTask )
+    {
+      submit();  // still scheduled, yield to other runners
+    }
+    else
+    {
+      // a producer that saw scheduled_ set before this store relies on the recheck below
+      scheduled_.store( false );
+      std::atomic_thread_fence( std::memory_order_seq_cst );
+      if ( !halted() && this->hasPendingCommand() && !scheduled_.exchange( true ) )
+      {
+        submit();
+      }
+    }
+
+    std::unique_lock< std::mutex > lock( idle_mutex_ );
+    tasks_in_flight_--;
+    idle_.notify_all();
+  }
+
+  void complete( const TResult& res )
+  {
+    if ( this->completion_handler_fun_ )
+    {
+      this->completion_handler_fun_( res );
+    }
+  }
+
+  RunnerExecutor& executor_;
+
+  std::atomic< bool > scheduled_{ false };
+  std::atomic< bool > deliver_initial_{ false };
+  std::atomic< bool > failed_{ false };
+
+  // lets the destructor wait for the last task
+  std::mutex              idle_mutex_;
+  std::condition_variable idle_;
+  std::size_t             tasks_in_flight_ = 0;
+};
+
+template < typename TEvent, typename TState, typename TCommandParameter, typename TResult, typename TClock >
+constexpr std::size_t PooledFiniteStateMachineRunner< TEvent, TState, TCommandParameter, TResult, TClock >::CommandsPerTask;
+
+}  // namespace fsm
@@ -34,31 +34,96 @@
 
 #pragma once
 
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
 #include <type_traits>
 #include <thread>
 
 #include "fsm_clocks.hpp"
+#include "fsm_rate_stats.hpp"
+#include "fsm_sleep_policy.hpp"
 
 namespace fsm {
 /**
- * @brief Heavily influence by ROS Rate, Duration, but for std::chrono
+ * @brief What a rate does when a cycle ends after its deadline
+ */
+enum class OverrunPolicy
+{
+  CATCH_UP_WITHIN_PERIOD,  // return at once for missed deadlines up to a period late, re-phase beyond
+  CATCH_UP,                // return at once for every missed deadline, keeping the phase
+  SKIP,                    // drop the missed deadlines and sleep until the next one, keeping the phase
+  REPHASE                  // start the next cycle now
+};
+
+/**
+ * @brief Rate on integer std::chrono time points and durations, the implementation behind every rate. Deadlines
+ * are exact, however long it runs and however short the period, and sleeps wait for the absolute deadline so late
+ * wakeups do not accumulate. A cycle that ends after its deadline is handled according to the OverrunPolicy.
  *
- * @tparam TClock
+ * @tparam TChronoClock std::chrono clock, or FSMChronoClock over an FSM clock
+ * @tparam TDuration Integer duration of the period
+ * @tparam TSleeper How to sleep until a deadline, see fsm_sleep_policy.hpp
+ * @tparam TStatistics Records every cycle, RateStatistics or the default NoRateStatistics which costs nothing
  */
-template < typename TClock >
-class BaseRate
+template < typename TChronoClock, typename TDuration = std::chrono::nanoseconds, typename TSleeper = ChronoSleeper, typename TStatistics = NoRateStatistics >
+class BaseChronoRate : private TStatistics
 {
  public:
-  BaseRate( double frequency ) 
-  : start_( TClock::toSec() )
-  , expected_cycle_time_( 1.0 / frequency )
-  {}
+  using TimePoint = std::chrono::time_point< TChronoClock, TDuration >;
+
+  /**
+   * @brief Construct a new Base Chrono Rate object
+   *
+   * @param period Length of a cycle
+   * @param overrun_policy What to do with a cycle that ends after its deadline
+   * @throw std::invalid_argument if period is zero or negative
+   */
+  explicit BaseChronoRate( TDuration period, OverrunPolicy overrun_policy = OverrunPolicy::CATCH_UP_WITHIN_PERIOD )
+    : start_( std::chrono::time_point_cast< TDuration >( TChronoClock::now() ) )
+    , expected_cycle_time_( checkedPeriod( period ) )
+    , overrun_policy_( overrun_policy )
+  {
+  }
+
+  /**
+   * @brief Adapter for a frequency in Hz, the period is rounded to the nearest TDuration
+   *
+   * @throw std::invalid_argument if frequency is not positive or so high that the period rounds to zero
+   */
+  explicit BaseChronoRate( double frequency, OverrunPolicy overrun_policy = OverrunPolicy::CATCH_UP_WITHIN_PERIOD )
+    : BaseChronoRate( frequencyPeriod( frequency ), overrun_policy )
+  {
+  }
+
+  void setOverrunPolicy( OverrunPolicy overrun_policy )
+  {
+    overrun_policy_ = overrun_policy;
+  }
+
+  /**
+   * @brief Starts the current cycle now
+   */
+  void reset()
+  {
+    start_ = std::chrono::time_point_cast< TDuration >( TChronoClock::now() );
+  }
 
   void sleep()
   {
-    double expected_end = start_ + expected_cycle_time_;
+    sleeper_.sleepUntil( nextCycle() );
+  }
 
-    double actual_end = TClock::toSec();
+  /**
+   * @brief Ends the current cycle as sleep does, applying the overrun policy and recording the statistics, but
+   * returns instead of sleeping. For callers that wait on something else meanwhile, e.g. a condition variable.
+   *
+   * @return Start of the next cycle, the time sleep would wait for
+   */
+  TimePoint nextCycle()
+  {
+    TimePoint       expected_end = start_ + expected_cycle_time_;
+    const TimePoint actual_end   = std::chrono::time_point_cast< TDuration >( TChronoClock::now() );
 
     // deal with a backwards jump
     if ( actual_end < start_ )
@@ -66,55 +131,266 @@ class BaseRate
       expected_end = actual_end + expected_cycle_time_;
     }
 
-    // next sleep duration
-    double sleep_duration = expected_end - actual_end;
-
-    // set actual loop time
     actual_cycle_time_ = actual_end - start_;
+    start_             = expected_end;
 
-    start_ = expected_end;
+    TStatistics::recordCycle( seconds( actual_cycle_time_ ), seconds( expected_cycle_time_ ), seconds( actual_end - expected_end ) );
 
-    if ( sleep_duration <= 0 )
+    if ( actual_end >= expected_end )
     {
-      // jump or past cycle, reset cycle
-      if ( actual_end > expected_end + expected_cycle_time_ )
+      switch ( overrun_policy_ )
       {
-        start_ = actual_end;
+        case OverrunPolicy::CATCH_UP_WITHIN_PERIOD:
+          // jump or past cycle, reset cycle
+          if ( actual_end > expected_end + expected_cycle_time_ )
+          {
+            start_ = actual_end;
+            TStatistics::recordRephase();
+          }
+          break;
+
+        case OverrunPolicy::CATCH_UP:
+          break;
+
+        case OverrunPolicy::SKIP:
+          start_ = expected_end + ( ( actual_end - expected_end + expected_cycle_time_ - TDuration( 1 ) ) / expected_cycle_time_ ) * expected_cycle_time_;
+          break;
+
+        case OverrunPolicy::REPHASE:
+          start_ = actual_end;
+          TStatistics::recordRephase();
+          break;
       }
     }
 
-    sleep( sleep_duration );
+    return start_;
+  }
+
+  /**
+   * @brief Time left until the end of the current cycle, negative once it is overdue. Does not sleep or start a
+   * new cycle.
+   */
+  TDuration remaining() const
+  {
+    return start_ + expected_cycle_time_ - std::chrono::time_point_cast< TDuration >( TChronoClock::now() );
+  }
+
+  /**
+   * @brief End of the current cycle
+   */
+  TimePoint deadline() const
+  {
+    return start_ + expected_cycle_time_;
+  }
+
+  TDuration period() const
+  {
+    return expected_cycle_time_;
+  }
+
+  /**
+   * @brief Time the last cycle took until sleep was called
+   */
+  TDuration actualCycleTime() const
+  {
+    return actual_cycle_time_;
+  }
+
+  /**
+   * @brief Cycle statistics, see RateStatistics
+   */
+  TStatistics& statistics()
+  {
+    return *this;
+  }
+
+  const TStatistics& statistics() const
+  {
+    return *this;
+  }
+
+  TSleeper& sleeper()
+  {
+    return sleeper_;
   }
 
  protected:
-  double expected_cycle_time_;
-  double actual_cycle_time_ = 0;
-  double start_;
+  // SKIP divides by the period, and a period of zero or less never sleeps
+  static TDuration checkedPeriod( TDuration period )
+  {
+    if ( period <= TDuration::zero() )
+    {
+      throw std::invalid_argument( "rate period must be positive" );
+    }
+    return period;
+  }
 
- private:
-  void sleep(double duration)
+  static TDuration frequencyPeriod( double frequency )
+  {
+    if ( !( frequency > 0 ) )
+    {
+      throw std::invalid_argument( "rate frequency must be positive" );
+    }
+
+    const double ticks = std::round( 1.0 / frequency * TDuration::period::den / TDuration::period::num );
+    if ( !( ticks < static_cast< double >( TDuration::max().count() ) ) )
+    {
+      return TDuration::max();
+    }
+    return TDuration( static_cast< typename TDuration::rep >( ticks ) );
+  }
+
+  // the statistics policies record seconds
+  static double seconds( TDuration duration )
+  {
+    return std::chrono::duration< double >( duration ).count();
+  }
+
+  TimePoint     start_;
+  TDuration     expected_cycle_time_;
+  TDuration     actual_cycle_time_ = TDuration::zero();
+  OverrunPolicy overrun_policy_;
+  TSleeper      sleeper_;
+};
+
+template < typename TChronoClock, typename TDuration = std::chrono::nanoseconds >
+class BaseChronoTimer : public BaseChronoRate< TChronoClock, TDuration >
+{
+ public:
+  /**
+   * @brief A timer that does not elapse until set_timeout
+   */
+  BaseChronoTimer()
+    : BaseChronoRate< TChronoClock, TDuration >( TDuration::max() )
+  {
+  }
+
+  /**
+   * @throw std::invalid_argument if timeout is zero or negative
+   */
+  explicit BaseChronoTimer( TDuration timeout )
+    : BaseChronoRate< TChronoClock, TDuration >( timeout )
+  {
+  }
+
+  /**
+   * @throw std::invalid_argument if timeout is zero or negative
+   */
+  void set_timeout( TDuration timeout )
+  {
+    this->expected_cycle_time_ = this->checkedPeriod( timeout );
+  }
+
+  bool isElapsed() const
+  {
+    return TChronoClock::now() - this->start_ >= this->expected_cycle_time_;
+  }
+};
+
+/**
+ * @brief Heavily influence by ROS Rate, Duration. Takes and reports double seconds of an FSM clock, the cycles are
+ * run by a BaseChronoRate on integer nanoseconds of TClock.
+ *
+ * @tparam TClock
+ * @tparam TStatistics Records every cycle, RateStatistics or the default NoRateStatistics which costs nothing
+ */
+template < typename TClock, typename TStatistics = NoRateStatistics >
+class BaseRate
+{
+ public:
+  using ChronoRate = BaseChronoRate< typename TClock::ChronoClock, std::chrono::nanoseconds, ClockSleeper< TClock >, TStatistics >;
+
+  /**
+   * @throw std::invalid_argument if frequency is not positive or so high that the period rounds to zero
+   */
+  BaseRate( double frequency, OverrunPolicy overrun_policy = OverrunPolicy::CATCH_UP_WITHIN_PERIOD )
+    : rate_( frequency, overrun_policy )
+  {
+  }
+
+  void setOverrunPolicy( OverrunPolicy overrun_policy )
+  {
+    rate_.setOverrunPolicy( overrun_policy );
+  }
+
+  void sleep()
+  {
+    rate_.sleep();
+  }
+
+  /**
+   * @brief Seconds the last cycle took until sleep was called
+   */
+  double actualCycleTime() const
+  {
+    return toSeconds( rate_.actualCycleTime() );
+  }
+
+  /**
+   * @brief Cycle statistics, see RateStatistics
+   */
+  TStatistics& statistics()
+  {
+    return rate_.statistics();
+  }
+
+  const TStatistics& statistics() const
+  {
+    return rate_.statistics();
+  }
+
+  /**
+   * @brief Seconds left until the end of the current cycle, negative once it is overdue. Does not sleep or
+   * start a new cycle.
+   */
+  double remaining() const
+  {
+    return toSeconds( rate_.remaining() );
+  }
+
+  /**
+   * @brief The integer rate running the cycles
+   */
+  ChronoRate& chrono()
+  {
+    return rate_;
+  }
+
+  const ChronoRate& chrono() const
   {
-    std::this_thread::sleep_for( std::chrono::duration<double>( duration ) );
+    return rate_;
   }
+
+ private:
+  ChronoRate rate_;
 };
 
 template <typename TClock>
-class BaseTimer : public BaseRate<TClock>
+class BaseTimer
 {
   public:
-    BaseTimer() : BaseRate<TClock>(0) {}
-    BaseTimer( double time_secs ) : BaseRate<TClock>( 1 / time_secs ) {}
-    void reset()
-    {
-      BaseRate<TClock>::start_ = TClock::toSec();
-    }
+    using ChronoTimer = BaseChronoTimer<typename TClock::ChronoClock>;
 
-    void set_timeout( double time_secs ) { BaseRate<TClock>::expected_cycle_time_ = time_secs; }
+    BaseTimer() {}
 
-    bool isElapsed()
-    {
-      return TClock::toSec() - BaseRate<TClock>::start_ >= BaseRate<TClock>::expected_cycle_time_;
-    }
+    /**
+     * @throw std::invalid_argument if time_secs is not positive
+     */
+    BaseTimer( double time_secs ) : timer_( toNanoseconds( time_secs ) ) {}
+
+    void reset() { timer_.reset(); }
+
+    /**
+     * @throw std::invalid_argument if time_secs is not positive
+     */
+    void set_timeout( double time_secs ) { timer_.set_timeout( toNanoseconds( time_secs ) ); }
+
+    bool isElapsed() const { return timer_.isElapsed(); }
+
+    ChronoTimer& chrono() { return timer_; }
+
+  private:
+    ChronoTimer timer_;
 };
 
 using SteadyRate = BaseRate< FSMSteadyClock >;
@@ -125,6 +401,24 @@ using SteadyTimer = BaseTimer< FSMSteadyClock >;
 using HighResTimer = BaseTimer< FSMHighResClock >;
 using SystemTimer = BaseTimer< FSMSystemClock >;
 
+using SteadyChronoRate = BaseChronoRate< std::chrono::steady_clock >;
+using HighResChronoRate = BaseChronoRate< std::chrono::high_resolution_clock >;
+using SystemChronoRate = BaseChronoRate< std::chrono::system_clock >;
+
+using SteadyChronoTimer = BaseChronoTimer< std::chrono::steady_clock >;
+using HighResChronoTimer = BaseChronoTimer< std::chrono::high_resolution_clock >;
+using SystemChronoTimer = BaseChronoTimer< std::chrono::system_clock >;
+
+#ifdef __linux__
+using MonotonicRate = BaseChronoRate< std::chrono::steady_clock, std::chrono::nanoseconds, AbsoluteMonotonicSleeper >;
+using HybridRate = BaseChronoRate< std::chrono::steady_clock, std::chrono::nanoseconds, HybridSpinSleeper< AbsoluteMonotonicSleeper > >;
+#else
+using HybridRate = BaseChronoRate< std::chrono::steady_clock, std::chrono::nanoseconds, HybridSpinSleeper<> >;
+#endif
+
+using VirtualRate = BaseRate< FSMVirtualClock >;
+using VirtualTimer = BaseTimer< FSMVirtualClock >;
+
 #ifdef USE_ROS_TIME
 using ROSRate = BaseRate< FSMROSClock >;
 
@@ -0,0 +1,203 @@
+/**
+ * @file fsm_rate_stats.hpp
+ * @brief Harmony FSM rate cycle statistics
+ * @date 2026-10-16
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace fsm
+{
+/**
+ * @brief Statistics policy of BaseRate that records nothing, the default. Its calls compile away.
+ */
+struct NoRateStatistics
+{
+  void recordCycle( double, double, double )
+  {
+  }
+
+  void recordRephase()
+  {
+  }
+};
+
+/**
+ * @brief Statistics policy of BaseRate: a histogram of cycle times, overruns, re-phases, the largest lateness
+ * and an exponentially weighted mean cycle time. The rate's thread records without locks or waiting. Any thread
+ * may read a snapshot, or take one and start a new reporting window.
+ */
+class RateStatistics
+{
+ public:
+  // bucket i counts cycles of [ i, i + 1 ) eighths of the period, the last one the cycles of two periods or more
+  static constexpr std::size_t BucketsPerPeriod = 8;
+  static constexpr std::size_t BucketCount      = 2 * BucketsPerPeriod + 1;
+
+  // weight of the newest cycle in the mean cycle time
+  static constexpr double MeanWeight = 1.0 / 16;
+
+  struct Snapshot
+  {
+    std::uint64_t                            Cycles        = 0;
+    std::uint64_t                            Overruns      = 0;  // cycles that ended after their deadline
+    std::uint64_t                            Rephases      = 0;  // overruns of more than a period, restarting the phase
+    double                                   MaxLateness   = 0;  // seconds past the deadline
+    double                                   MeanCycleTime = 0;  // seconds, exponentially weighted
+    std::array< std::uint64_t, BucketCount > Histogram{};
+  };
+
+  /**
+   * @brief Records a cycle, called by the rate
+   *
+   * @param cycle_time Seconds the cycle took until sleep was called
+   * @param expected_cycle_time The period in seconds
+   * @param lateness Seconds past the deadline, negative when on time
+   */
+  void recordCycle( double cycle_time, double expected_cycle_time, double lateness )
+  {
+    std::size_t bucket = BucketCount - 1;
+    if ( cycle_time < 2 * expected_cycle_time )
+    {
+      bucket = cycle_time > 0 ? static_cast< std::size_t >( cycle_time / expected_cycle_time * BucketsPerPeriod ) : 0;
+    }
+
+    Counters& counters = beginRecord();
+    counters.cycles.fetch_add( 1, std::memory_order_relaxed );
+    counters.histogram[bucket].fetch_add( 1, std::memory_order_relaxed );
+    if ( lateness > 0 )
+    {
+      counters.overruns.fetch_add( 1, std::memory_order_relaxed );
+      if ( lateness > counters.max_lateness.load( std::memory_order_relaxed ) )
+      {
+        counters.max_lateness.store( lateness, std::memory_order_relaxed );
+      }
+    }
+    endRecord();
+
+    // only this thread writes the mean
+    const double mean = mean_cycle_time_.load( std::memory_order_relaxed );
+    mean_cycle_time_.store( mean == 0 ? cycle_time : mean + MeanWeight * ( cycle_time - mean ), std::memory_order_relaxed );
+  }
+
+  void recordRephase()
+  {
+    beginRecord().rephases.fetch_add( 1, std::memory_order_relaxed );
+    endRecord();
+  }
+
+  /**
+   * @brief Reads the statistics of the current reporting window. A cycle being recorded meanwhile may show in some
+   * counters and not yet in others.
+   */
+  Snapshot snapshot() const
+  {
+    const Counters& counters = windows_[window_.load( std::memory_order_seq_cst )];
+
+    Snapshot res;
+    res.Cycles        = counters.cycles.load( std::memory_order_relaxed );
+    res.Overruns      = counters.overruns.load( std::memory_order_relaxed );
+    res.Rephases      = counters.rephases.load( std::memory_order_relaxed );
+    res.MaxLateness   = counters.max_lateness.load( std::memory_order_relaxed );
+    res.MeanCycleTime = mean_cycle_time_.load( std::memory_order_relaxed );
+    for ( std::size_t i = 0; i < BucketCount; i++ )
+    {
+      res.Histogram[i] = counters.histogram[i].load( std::memory_order_relaxed );
+    }
+    return res;
+  }
+
+  /**
+   * @brief Reads the statistics of the current reporting window and starts a new one. The rate records into one
+   * of two windows: taking switches it to the other and waits out a record still going to the taken one, so every
+   * cycle is counted in exactly one window with all of its counters. The mean cycle time carries over. Concurrent
+   * takers are serialized, the recording thread never waits for them.
+   */
+  Snapshot takeWindow()
+  {
+    std::lock_guard< std::mutex > lock( take_mutex_ );
+    const std::size_t             taken = window_.load( std::memory_order_relaxed );
+    window_.store( 1 - taken, std::memory_order_seq_cst );
+    while ( recording_.load( std::memory_order_seq_cst ) )
+    {
+      std::this_thread::yield();
+    }
+    Counters& counters = windows_[taken];
+
+    Snapshot res;
+    res.Cycles        = counters.cycles.exchange( 0, std::memory_order_relaxed );
+    res.Overruns      = counters.overruns.exchange( 0, std::memory_order_relaxed );
+    res.Rephases      = counters.rephases.exchange( 0, std::memory_order_relaxed );
+    res.MaxLateness   = counters.max_lateness.exchange( 0, std::memory_order_relaxed );
+    res.MeanCycleTime = mean_cycle_time_.load( std::memory_order_relaxed );
+    for ( std::size_t i = 0; i < BucketCount; i++ )
+    {
+      res.Histogram[i] = counters.histogram[i].exchange( 0, std::memory_order_relaxed );
+    }
+    return res;
+  }
+
+ private:
+  struct Counters
+  {
+    std::atomic< std::uint64_t >                            cycles{ 0 };
+    std::atomic< std::uint64_t >                            overruns{ 0 };
+    std::atomic< std::uint64_t >                            rephases{ 0 };
+    std::atomic< double >                                   max_lateness{ 0 };
+    std::array< std::atomic< std::uint64_t >, BucketCount > histogram{};
+  };
+
+  // a taker that switched windows after the window was loaded here sees recording_ set until endRecord
+  Counters& beginRecord()
+  {
+    recording_.store( true, std::memory_order_seq_cst );
+    return windows_[window_.load( std::memory_order_seq_cst )];
+  }
+
+  void endRecord()
+  {
+    recording_.store( false, std::memory_order_release );
+  }
+
+  Counters                   windows_[2];
+  std::atomic< std::size_t > window_{ 0 };
+  std::atomic< bool >        recording_{ false };
+  std::atomic< double >      mean_cycle_time_{ 0 };
+  std::mutex                 take_mutex_;
+};
+
+}  // namespace fsm
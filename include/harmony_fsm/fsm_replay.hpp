@@ -0,0 +1,254 @@
+/**
+ * @file fsm_replay.hpp
+ * @brief Harmony FSM parallel replay of one long event stream
+ * @date 2026-10-16
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "dense_transition_table.hpp"
+#include "fsm_shared_table.hpp"
+#include "fsm_thread_pool.hpp"
+
+namespace fsm
+{
+/**
+ * @class ParallelReplay
+ * @brief Offline replay of a recorded event stream through a single machine, split across a thread pool.
+ *
+ * The stream is cut into chunks. Every chunk but the first is run from every possible start state at once, which
+ * yields a state to state mapping for the chunk. Composing the mappings in order from the initial state gives the
+ * true state at every chunk boundary, after which the per-event states are filled in parallel. Invalid events
+ * leave the state unchanged, as with FiniteStateMachine::doEvent.
+ *
+ * @tparam TEvent Event type, needs a COUNT sentinel or an EnumTraits specialization
+ * @tparam TState State type, needs a COUNT sentinel or an EnumTraits specialization
+ */
+template < typename TEvent, typename TState >
+class ParallelReplay
+{
+ public:
+  using TransitionTable = DenseTransitionTable< TEvent, TState >;
+  using state_type      = typename TransitionTable::code_type;
+
+  /**
+   * @brief Construct a new Parallel Replay object
+   *
+   * @param fsm_table Valid transition table
+   */
+  explicit ParallelReplay( const std::vector< EventTableEntry< TEvent, TState > >& fsm_table )
+    : ParallelReplay( std::make_shared< const TransitionTable >( fsm_table ) )
+  {
+  }
+
+  /**
+   * @brief Construct a new Parallel Replay object on a shared table
+   *
+   * @param table Immutable transition table, refcounted or borrowed
+   */
+  explicit ParallelReplay( std::shared_ptr< const TransitionTable > table )
+    : table_( std::move( table ) )
+    , total_codes_( TransitionTable::StateCount * TransitionTable::EventCount )
+  {
+    // total transition function, undefined transitions keep the state
+    for ( std::size_t s = 0; s < TransitionTable::StateCount; s++ )
+    {
+      for ( std::size_t e = 0; e < TransitionTable::EventCount; e++ )
+      {
+        const state_type code = table_->code( s, e );
+
+        total_codes_[s * TransitionTable::EventCount + e] = code == TransitionTable::InvalidCode ? static_cast< state_type >( s ) : code;
+      }
+    }
+  }
+
+  /**
+   * @brief Minimum number of events per chunk, shorter streams are replayed on fewer chunks
+   *
+   * @param min_chunk_size events
+   */
+  void setMinChunkSize( std::size_t min_chunk_size )
+  {
+    min_chunk_size_ = std::max< std::size_t >( min_chunk_size, 1 );
+  }
+
+  /**
+   * @brief Replays a stream on the calling thread
+   *
+   * @param init_state State before the first event
+   * @param first First event
+   * @param last One past the last event
+   * @param states_out Optional, last - first states, the state after each event
+   * @return TState State after the last event
+   */
+  TState replay( TState init_state, const TEvent* first, const TEvent* last, TState* states_out = nullptr ) const
+  {
+    return static_cast< TState >( run( checkedIndex( init_state ), first, last, states_out ) );
+  }
+
+  /**
+   * @brief Replays a stream across a thread pool
+   *
+   * @param pool Pool to run on, the calling thread helps
+   * @param init_state State before the first event
+   * @param first First event
+   * @param last One past the last event
+   * @param states_out Optional, last - first states, the state after each event
+   * @return TState State after the last event
+   */
+  TState replay( WorkStealingThreadPool& pool, TState init_state, const TEvent* first, const TEvent* last, TState* states_out = nullptr ) const
+  {
+    const state_type  init   = checkedIndex( init_state );
+    const std::size_t count  = static_cast< std::size_t >( last - first );
+    const std::size_t chunks = std::max< std::size_t >( 1, std::min( pool.size() * ChunksPerThread, count / min_chunk_size_ ) );
+    if ( chunks == 1 )
+    {
+      return static_cast< TState >( run( init, first, last, states_out ) );
+    }
+
+    const std::size_t chunk      = ( count + chunks - 1 ) / chunks;
+    auto              chunkBegin = [&]( std::size_t c ) { return first + std::min( count, c * chunk ); };
+
+    // chunk c maps start state s to mappings[c * StateCount + s]. The first chunk has a known start and
+    // is replayed directly, its end state stored for every start.
+    std::vector< state_type > mappings( chunks * TransitionTable::StateCount );
+    pool.parallelFor( chunks, [&]( std::size_t c ) {
+      if ( c == 0 )
+      {
+        std::fill_n( mappings.begin(), TransitionTable::StateCount, run( init, chunkBegin( 0 ), chunkBegin( 1 ), states_out ) );
+      }
+      else
+      {
+        enumerate( chunkBegin( c ), chunkBegin( c + 1 ), &mappings[c * TransitionTable::StateCount] );
+      }
+    } );
+
+    // compose the mappings in stream order to find the true state at each boundary
+    std::vector< state_type > boundaries( chunks + 1 );
+    boundaries[0] = init;
+    for ( std::size_t c = 0; c < chunks; c++ )
+    {
+      boundaries[c + 1] = mappings[c * TransitionTable::StateCount + boundaries[c]];
+    }
+
+    if ( states_out )
+    {
+      pool.parallelFor( chunks - 1, [&]( std::size_t c ) {
+        run( boundaries[c + 1], chunkBegin( c + 1 ), chunkBegin( c + 2 ), states_out + ( chunkBegin( c + 1 ) - first ) );
+      } );
+    }
+
+    return static_cast< TState >( boundaries[chunks] );
+  }
+
+ private:
+  static constexpr std::size_t ChunksPerThread = 4;
+
+  // events between checks for all start states having merged into one
+  static constexpr std::size_t ConvergenceInterval = 64;
+
+  static state_type checkedIndex( TState state )
+  {
+    if ( !TransitionTable::isStateInRange( state ) )
+    {
+      throw std::out_of_range( "initial state outside of the TState enum range" );
+    }
+
+    return static_cast< state_type >( enumIndex( state ) );
+  }
+
+  state_type step( state_type state, const TEvent& trigger ) const
+  {
+    const std::size_t event_idx = enumIndex( trigger );
+    return event_idx < TransitionTable::EventCount ? total_codes_[state * TransitionTable::EventCount + event_idx] : state;
+  }
+
+  state_type run( state_type state, const TEvent* first, const TEvent* last, TState* states_out ) const
+  {
+    for ( const TEvent* evt = first; evt != last; evt++ )
+    {
+      state = step( state, *evt );
+      if ( states_out )
+      {
+        *states_out++ = static_cast< TState >( state );
+      }
+    }
+
+    return state;
+  }
+
+  /**
+   * @brief Runs a chunk from every start state at once. Machines tend to synchronize, once every start state
+   * has reached the same state the remainder of the chunk is run once.
+   */
+  void enumerate( const TEvent* first, const TEvent* last, state_type* mapping ) const
+  {
+    for ( std::size_t s = 0; s < TransitionTable::StateCount; s++ )
+    {
+      mapping[s] = static_cast< state_type >( s );
+    }
+
+    const TEvent* evt = first;
+    while ( evt != last )
+    {
+      const TEvent* block_end = evt + std::min< std::size_t >( ConvergenceInterval, last - evt );
+      for ( ; evt != block_end; evt++ )
+      {
+        for ( std::size_t s = 0; s < TransitionTable::StateCount; s++ )
+        {
+          mapping[s] = step( mapping[s], *evt );
+        }
+      }
+
+      if ( std::all_of( mapping, mapping + TransitionTable::StateCount, [&]( state_type state ) { return state == mapping[0]; } ) )
+      {
+        std::fill_n( mapping, TransitionTable::StateCount, run( mapping[0], evt, last, nullptr ) );
+        return;
+      }
+    }
+  }
+
+  std::shared_ptr< const TransitionTable > table_;
+  std::vector< state_type >                total_codes_;
+  std::size_t                              min_chunk_size_ = 4096;
+};
+
+template < typename TEvent, typename TState >
+constexpr std::size_t ParallelReplay< TEvent, TState >::ChunksPerThread;
+
+template < typename TEvent, typename TState >
+constexpr std::size_t ParallelReplay< TEvent, TState >::ConvergenceInterval;
+
+}  // namespace fsm
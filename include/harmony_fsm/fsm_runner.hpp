@@ -34,28 +34,44 @@
 
 #pragma once
 
-#include <array>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <type_traits>
 #include <map>
 
 #include "fsm_rate.hpp"
-#include "finite_state_machine.hpp"
+#include "fsm_runner_base.hpp"
 
 namespace fsm
 {
-using UnusedCommandParameter = int;
 /**
  * @brief Runs a generic Finite State Machine in a watchdog/worker thread model.
- * Provides callbacks and functions for state machine responses and timeouts.
+ * Provides callbacks and functions for state machine responses and timeouts. The worker wakes the watchdog
+ * when a result is ready, which delivers it to the completion handler right away. A completion handler that
+ * re-kicks a polled state therefore runs it as fast as the worker can; setPacedCompletion paces the results at
+ * the runner frequency instead.
+ * State functions run outside of the command lock. Commands are handed to the worker through a bounded
+ * lock-free queue, see setCommandQueue, and the worker is only signalled when it is parked. Timeouts are
+ * supervised by the shared TimeoutSupervisor, the watchdog only wakes up for results.
+ * Set the functions and handlers before calling start.
+ *
+ * @tparam TSleeper How paced completion sleeps, see fsm_sleep_policy.hpp. The default ClockSleeper waits on a
+ * condition variable, so stop and newer results wake it at once. Others, e.g. AbsoluteMonotonicSleeper or
+ * HybridSpinSleeper on FSMSteadyClock, sleep until the absolute deadline with the result lock released, which can
+ * delay stop by up to a period.
  */
-template < typename TEvent, typename TState, typename TCommandParameter, typename TResult, typename TClock >
-class FiniteStateMachineRunner : public FiniteStateMachine< TEvent, TState >
+template < typename TEvent, typename TState, typename TCommandParameter, typename TResult, typename TClock, typename TSleeper = ClockSleeper< TClock > >
+class FiniteStateMachineRunner : public FiniteStateMachineRunnerBase< TEvent, TState, TCommandParameter, TResult, TClock >
 {
+  using Base          = FiniteStateMachineRunnerBase< TEvent, TState, TCommandParameter, TResult, TClock >;
+  using QueuedCommand = typename Base::QueuedCommand;
+  using DeliveryRate  = BaseChronoRate< typename TClock::ChronoClock, std::chrono::nanoseconds, TSleeper >;
+
  public:
   /**
    * @brief Construct a new Finite State Machine Runner object, single function for execution by default
@@ -63,12 +79,14 @@ class FiniteStateMachineRunner : public FiniteStateMachine< TEvent, TState >
    * @param fsm_table Valid transition table
    * @param init_state Initial state
    * @param init_result The initial result to process when kicked by the completion_handler at startup
-   * @param frequency Frequency at which to run the watchdog timer, max speed of runner
+   * @param frequency Frequency at which to run the watchdog timer: with paced completion results reach the completion handler
+   * at most this often (see setPacedCompletion), and the timeout handler repeats this often while unresponsive
    * @param exec_fun Single function through which all states execute
    * @param completion_handler Function through which execution results are processed. Kick into new states here
    * @param pre_exec_fun Function to run before executing any state function
    * @param timeout_handler If an execution function takes longer that timeout (see setTimeout), execute this function
    * @param exception_handler If an exception is thrown during an execution function, it will propogate to this handler
+   * @throw std::invalid_argument if frequency is not positive
    */
   FiniteStateMachineRunner( std::vector< EventTableEntry< TEvent, TState > >     fsm_table,
                             TState                                               init_state,
@@ -79,13 +97,9 @@ class FiniteStateMachineRunner : public FiniteStateMachine< TEvent, TState >
                             std::function< void( const TCommandParameter* ) >    pre_exec_fun       = nullptr,
                             std::function< void( double ) >                      timeout_handler    = nullptr,
                             std::function< void( const std::exception& ) >       exception_handler  = nullptr )
-    : FiniteStateMachine< TEvent, TState >( fsm_table, init_state )
-    , rate_( BaseRate< TClock >( frequency ) )
-    , execute_fun_( exec_fun )
-    , completion_handler_fun_( completion_handler )
-    , pre_exec_fun_( pre_exec_fun )
-    , timeout_handler_fun_( timeout_handler )
-    , exception_handler_fun_( exception_handler )
+    : Base( fsm_table, init_state, init_result, exec_fun, completion_handler, pre_exec_fun, timeout_handler, exception_handler )
+    , delivery_rate_( frequency, OverrunPolicy::REPHASE )
+    , timeout_repeat_( timeoutRepeatPeriod( frequency ) )
     , last_worker_result_( init_result )
   {
     init();
@@ -97,12 +111,14 @@ class FiniteStateMachineRunner : public FiniteStateMachine< TEvent, TState >
    * @param fsm_table Valid transition table
    * @param init_state Initial state
    * @param init_result The initial result to process when kicked by the completion_handler
-   * @param frequency Frequency at which to run the watchdog timer, max speed of runner
+   * @param frequency Frequency at which to run the watchdog timer: with paced completion results reach the completion handler
+   * at most this often (see setPacedCompletion), and the timeout handler repeats this often while unresponsive
    * @param exec_fun_map A map of TState vs functions to execute for each state
    * @param completion_handler Function through which execution results are processed. Kick into new states here
    * @param pre_exec_fun Function to run before executing any state function
    * @param timeout_handler If an execution function takes longer that timeout (see setTimeout), execute this function
    * @param exception_handler If an exception is thrown during an execution function, it will propogate to this handler
+   * @throw std::invalid_argument if frequency is not positive
    */
   FiniteStateMachineRunner( std::vector< EventTableEntry< TEvent, TState > >                         fsm_table,
                             TState                                                                   init_state,
@@ -113,21 +129,14 @@ class FiniteStateMachineRunner : public FiniteStateMachine< TEvent, TState >
                             std::function< void( const TCommandParameter* ) >                        pre_exec_fun       = nullptr,
                             std::function< void( double ) >                                          timeout_handler    = nullptr,
                             std::function< void( const std::exception& ) >                           exception_handler  = nullptr )
-    : FiniteStateMachine< TEvent, TState >( fsm_table, init_state )
-    , rate_( BaseRate< TClock >( frequency ) )
-    , execute_fun_map_( exec_fun_map )
-    , completion_handler_fun_( completion_handler )
-    , pre_exec_fun_( pre_exec_fun )
-    , timeout_handler_fun_( timeout_handler )
-    , exception_handler_fun_( exception_handler )
+    : Base( fsm_table, init_state, init_result, exec_fun_map, completion_handler, pre_exec_fun, timeout_handler, exception_handler )
+    , delivery_rate_( frequency, OverrunPolicy::REPHASE )
+    , timeout_repeat_( timeoutRepeatPeriod( frequency ) )
     , last_worker_result_( init_result )
   {
     init();
   }
 
-  FiniteStateMachineRunner(const FiniteStateMachineRunner&) = delete;
-  void operator=(const FiniteStateMachineRunner&) = delete;
-
   virtual ~FiniteStateMachineRunner()
   {
     stop();
@@ -143,326 +152,259 @@ class FiniteStateMachineRunner : public FiniteStateMachine< TEvent, TState >
   }
 
   /**
-   * @brief Starts running threads
-   * 
-   */
-  void start()
-  {
-    shutdown_desired_ = false;
-    has_new_command_  = false;
-    has_new_result_   = false;
-    worker_ready_     = false;
-    worker_           = std::thread( &FiniteStateMachineRunner::workerThread, this );
-    watchdog_         = std::thread( &FiniteStateMachineRunner::watchdogThread, this );
-  }
-
-  /**
-   * @brief Issues stop request to threads
-   * 
-   */
-  void stop()
-  {
-    shutdown_desired_ = true;
-    cond_wakeup_.notify_all();
-  }
-
-  /**
-   * @brief Returns whether threads are currently attempting to stop 
-   * 
-   * @return true Stop has been requested 
-   * @return false Stop has not been requested
-   */
-  bool stopping()
-  {
-    return shutdown_desired_;
-  }
-
-  /**
-   * @brief Set the execution function map. 
-   * 
-   * @param execute_fun_map map of functions by state
-   */
-  void setExecFunctionMap( std::map< TState, std::function< TResult( const TCommandParameter* ) > > execute_fun_map )
-  {
-    execute_fun_map_ = execute_fun_map;
-  }
-
-  /**
-   * @brief Set the execution function to run in every state
-   * 
-   * @param execute_fun Execution function to run in every state
-   */
-  void setExecFunction( std::function< TResult( const TCommandParameter* ) > execute_fun )
-  {
-    execute_fun_ = execute_fun;
-  }
-
-  /**
-   * @brief Set the function to execute prior to that state function
-   * 
-   * @param pre_exec_fun Function to execute prior to that state function
-   */
-  void setPreExecFunction( std::function< void( const TCommandParameter* ) > pre_exec_fun )
-  {
-    pre_exec_fun_ = pre_exec_fun;
-  }
-
-  /**
-   * @brief Set the handler to process the results of execution functions
-   * 
-   * @param completion_handler Handler to process the results of execution functions
+   * @brief Whether results are paced at the runner frequency. Unpaced, the default, every result is delivered as
+   * soon as the worker stores it, and a completion handler re-kicking a polled state busy-loops unless it paces
+   * itself. Paced, the completion handler runs at most once per period: a result ready within a period of the
+   * last one waits for the period to end, one after a longer pause is delivered right away.
+   *
+   * @param paced Pace the completion handler at the runner frequency
    */
-  void setCompletionHandler( std::function< void( const TResult& ) > completion_handler )
+  void setPacedCompletion( bool paced )
   {
-    completion_handler_fun_ = completion_handler;
+    {
+      std::lock_guard< std::mutex > lock( result_mutex_ );
+      paced_ = paced;
+    }
+    result_wakeup_.notify_all();
   }
 
   /**
-   * @brief Set the handler to process exceptions thrown during execution functions
-   * 
-   * @param exception_handler Handler to process exceptions thrown during execution functions
+   * @brief What paced completion does with results held back by a stall longer than a period, REPHASE by default:
+   * the next result is delivered right away and starts a new period. CATCH_UP delivers a result per missed period
+   * back to back, SKIP holds the next result until the next period on the original phase, see OverrunPolicy.
+   *
+   * @param overrun_policy Overrun policy of the delivery rate
    */
-  void setExceptionHandler( std::function< void( const std::exception& ) > exception_handler )
+  void setOverrunPolicy( OverrunPolicy overrun_policy )
   {
-    exception_handler_fun_ = exception_handler;
+    std::lock_guard< std::mutex > lock( result_mutex_ );
+    delivery_rate_.setOverrunPolicy( overrun_policy );
   }
 
   /**
-   * @brief Set the handler to process timeouts as defined by setTimeout
-   * 
-   * @param exception_handler Handler to process timeouts as defined by setTimeout
+   * @brief Sleeper of paced completion, e.g. to set the spin limit of a HybridSpinSleeper. Configure it before
+   * start.
    */
-  void setTimeoutHandler( std::function< void( const double ) > timeout_handler )
+  TSleeper& deliverySleeper()
   {
-    timeout_handler_fun_ = timeout_handler;
+    return delivery_rate_.sleeper();
   }
 
   /**
-   * @brief Set the timeout in sec before invoking the timeout handler
+   * @brief Starts running threads
    * 
-   * @param seconds seconds
    */
-  void setTimeout( double seconds )
+  void start() override
   {
-    timeout_ = seconds;
+    this->shutdown_desired_ = false;
+    first_delivery_         = true;
+    has_new_result_         = false;
+    worker_ready_           = false;
+    this->commands_->open();
+    this->superviseTimeout( timeout_repeat_ );
+    worker_   = std::thread( &FiniteStateMachineRunner::workerThread, this );
+    watchdog_ = std::thread( &FiniteStateMachineRunner::watchdogThread, this );
   }
 
   /**
-   * @brief Steps the state machine and if successfully transitioned, executes the associated function
+   * @brief Issues stop request to threads
    * 
-   * @param trigger Event trigger
-   * @param command Parameter object to pass to execution function
-   * @return true Returns true if transition was successful
-   * @return false Returns false if transition was not successful
    */
-  bool doEventAndExecute( const TEvent& trigger, TCommandParameter&& command )
+  void stop() override
   {
-    if ( FiniteStateMachine< TEvent, TState >::doEvent( trigger ) )
+    this->shutdown_desired_ = true;
+    this->commands_->close();
+    this->releaseTimeout();
     {
-      updateFSM( std::forward<TCommandParameter>( command ) );
-      return true;
+      std::lock_guard< std::mutex > lock( master_command_mutex_ );
+      cond_wakeup_.notify_all();
     }
-
-    return false;
+    result_wakeup_.notify_all();
   }
 
-  /**
-   * @brief Steps the state machine and if successfully transitioned, executes the associated function
-   * 
-   * @param trigger Event trigger
-   * @return true Returns true if transition was successful
-   * @return false Returns false if transition was not successful
-   */
-  bool doEventAndExecute( const TEvent& trigger )
+ protected:
+  // only take the lock when the worker is parked, it rechecks the queue after announcing that it parks
+  void notifyCommand() override
   {
-    if ( FiniteStateMachine< TEvent, TState >::doEvent( trigger ) )
+    if ( worker_parked_.load( std::memory_order_relaxed ) )
     {
-      updateFSM();
-      return true;
+      std::lock_guard< std::mutex > lock( master_command_mutex_ );
+      cond_wakeup_.notify_one();
     }
-
-    return false;
-  }
-
-  /**
-   * @brief Kicks the runner into execution function and passes the given command parameters
-   * 
-   * @param command Parameter object to pass to execution function
-   */
-  void updateFSM( TCommandParameter&& command )
-  {
-    std::unique_lock< std::mutex > lock( master_command_mutex_ );
-    command_         = std::forward<TCommandParameter>( command );
-    has_new_command_ = true;
-    cond_wakeup_.notify_all();
   }
 
-  /**
-   * @brief Kicks the runner into execution function
-   * 
-   */
-  void updateFSM()
-  {
-    std::unique_lock< std::mutex > lock( master_command_mutex_ );
-    has_new_command_ = true;
-    cond_wakeup_.notify_all();
-  }
-
- protected:
-  std::function< TResult( const TCommandParameter* ) >                     execute_fun_            = nullptr;
-  std::function< void( const TResult& ) >                                  completion_handler_fun_ = nullptr;
-  std::function< void( const TCommandParameter* ) >                        pre_exec_fun_           = nullptr;
-  std::function< void( double ) >                                          timeout_handler_fun_    = nullptr;
-  std::function< void( const std::exception& ) >                           exception_handler_fun_  = nullptr;
-  std::map< TState, std::function< TResult( const TCommandParameter* ) > > execute_fun_map_;
-
  private:
   /**
-   * @brief Runs a state machine step when the conditional variable is kicked by the UpdateCommand function
+   * @brief Runs a state machine step when the conditional variable is kicked by the UpdateCommand function.
+   * The pre-execution and state functions run outside of any lock, so they may call doEvent or updateFSM
+   * themselves.
    */
   void workerThread()
   {
+    {
+      std::lock_guard< std::mutex > result_lock( result_mutex_ );
+      worker_ready_ = true;
+    }
+    result_wakeup_.notify_all();
+
     try
     {
-      while ( !shutdown_desired_ )
+      while ( !this->shutdown_desired_ )
       {
-        std::unique_lock< std::mutex > lock( master_command_mutex_ );
-
-        worker_ready_ = true;
-        cond_wakeup_.wait( lock, [&]() { return has_new_command_ || shutdown_desired_; } );
+        QueuedCommand queued;
+        bool          popped = this->popCommand( queued );
 
-        auto execution_function = execute_fun_;
-        if ( execution_function == nullptr )
+        if ( !popped )
         {
-          auto it_fun = execute_fun_map_.find( FiniteStateMachine< TEvent, TState >::getCurrentState() );
-          if ( it_fun != end( execute_fun_map_ ) )
-          {
-            execution_function = it_fun->second;
-          }
-        }
+          std::unique_lock< std::mutex > lock( master_command_mutex_ );
+          worker_parked_.store( true, std::memory_order_relaxed );
+          std::atomic_thread_fence( std::memory_order_seq_cst );
+          cond_wakeup_.wait( lock, [&]() { return ( popped = this->popCommand( queued ) ) || this->shutdown_desired_; } );
+          worker_parked_.store( false, std::memory_order_relaxed );
 
-        if ( has_new_command_ && execution_function != nullptr )
-        {
-          if ( pre_exec_fun_ )
+          if ( !popped )
           {
-            pre_exec_fun_( &command_ );
-          }
-
-          if ( !shutdown_desired_ )
-          {
-            TResult res = execution_function( &command_ );
-            time_mutex_.lock();
-            last_worker_response_ = TClock::toSec();
-            time_mutex_.unlock();
-
-            result_mutex_.lock();
-            last_worker_result_ = std::move( res );
-            result_mutex_.unlock();
-            has_new_result_ = true;
+            continue;
           }
         }
 
-        has_new_command_ = false;
+        this->executeCommand( queued, TClock::sinceEpoch(), [&]( TResult&& res ) {
+          this->markResponse( TClock::sinceEpoch() );
+          result_mutex_.lock();
+          last_worker_result_ = std::move( res );
+          has_new_result_     = true;
+          result_mutex_.unlock();
+          result_wakeup_.notify_all();
+        } );
       }
     }
     catch ( std::exception& ex )
     {
-      if ( exception_handler_fun_ )
-      {
-        exception_handler_fun_( ex );
-      }
+      this->handleException( ex );
     }
   }
 
   /**
-   * @brief Controls the forward progression of the state machine, deals with timeouts
+   * @brief Controls the forward progression of the state machine. Results are handled as soon as the worker
+   * signals them, or at the pace of the runner frequency.
    */
   void watchdogThread()
   {
-    bool firstpass = true;
-    while ( !shutdown_desired_ )
     {
-      if ( !worker_ready_ )
-      {
-        while ( !worker_ready_ && !shutdown_desired_ )
-        {
-          rate_.sleep();  // wait for spinup
-        }
-        has_new_result_ = true;  // initial kick
-        cond_wakeup_.notify_all();
-      }
-      else
-      {
-        if ( firstpass )
-        {
-          has_new_result_ = true;
-        }
-      }
-
-      rate_.sleep();
+      // wait for spinup, then kick with the initial result
+      std::unique_lock< std::mutex > lock( result_mutex_ );
+      result_wakeup_.wait( lock, [&]() { return worker_ready_ || this->shutdown_desired_; } );
+      last_worker_result_ = this->init_result_;
+      has_new_result_     = true;
+    }
 
-      // TODO: check for outside requests, interrupts ?
+    while ( !this->shutdown_desired_ )
+    {
+      std::unique_lock< std::mutex > lock( result_mutex_ );
+      result_wakeup_.wait( lock, [&]() { return has_new_result_ || this->shutdown_desired_; } );
 
-      // check for new result
-      if ( has_new_result_ )
+      // check for new result, handled unlocked so the worker can store the next one meanwhile
+      if ( has_new_result_ && !this->shutdown_desired_ )
       {
-        std::unique_lock< std::mutex > lock( result_mutex_ );
-        if ( completion_handler_fun_ )
+        if ( !pace( lock ) )
         {
-          completion_handler_fun_( last_worker_result_ );
+          break;
         }
+        TResult res     = std::move( last_worker_result_ );
         has_new_result_ = false;
-      }
+        lock.unlock();
 
-      // check for timeout
-      if ( timeout_handler_fun_ )
-      {
-        std::unique_lock< std::mutex > lock( time_mutex_ );
-        if ( ( TClock::toSec() - last_worker_response_ ) > timeout_ )
+        if ( this->completion_handler_fun_ )
         {
-          timeout_handler_fun_( last_worker_response_ );
+          this->completion_handler_fun_( res );
         }
       }
+    }
+  }
+
+  /**
+   * @brief Paced, waits for the end of the delivery period and for the start of the next one, placed by the
+   * overrun policy. The worker may store newer results meanwhile, the newest is delivered next.
+   *
+   * @param lock Lock on result_mutex_, released while waiting
+   * @return false if stopped while waiting
+   */
+  bool pace( std::unique_lock< std::mutex >& lock )
+  {
+    if ( first_delivery_ )
+    {
+      first_delivery_ = false;
+      delivery_rate_.reset();
+      return !this->shutdown_desired_;
+    }
+
+    if ( paced_ )
+    {
+      waitUntil( lock, delivery_rate_.deadline() );
+    }
 
-      firstpass = false;
+    if ( paced_ )
+    {
+      // the period is over, the overrun policy places the next one, SKIP may start it later on the phase
+      waitUntil( lock, delivery_rate_.nextCycle() );
+    }
+    return !this->shutdown_desired_;
+  }
+
+  /**
+   * @brief Waits for a delivery deadline with the sleeper of the runner. ClockSleeper waits on result_wakeup_ and
+   * stops waiting once stopped or unpaced, other sleepers sleep through with the lock released.
+   */
+  void waitUntil( std::unique_lock< std::mutex >& lock, typename DeliveryRate::TimePoint deadline )
+  {
+    if ( !std::is_same< TSleeper, ClockSleeper< TClock > >::value )
+    {
+      lock.unlock();
+      delivery_rate_.sleeper().sleepUntil( deadline );
+      lock.lock();
+      return;
+    }
+
+    std::chrono::nanoseconds remaining{ 0 };
+    while ( paced_ && !this->shutdown_desired_ && ( remaining = deadline - DeliveryRate::TimePoint::clock::now() ) > std::chrono::nanoseconds::zero() )
+    {
+      result_wakeup_.wait_for( lock, ClockTraits< TClock >::waitFor( remaining ) );
     }
   }
 
   void init()
   {
-    shutdown_desired_     = false;
-    has_new_command_      = false;
-    has_new_result_       = false;
-    worker_ready_         = false;
-    last_worker_response_ = TClock::toSec();
+    worker_parked_  = false;
+    has_new_result_ = false;
+    worker_ready_   = false;
   }
 
   // when receiving a new command, kick the state machine into action
   std::condition_variable cond_wakeup_;
 
+  // when the worker is ready or has a new result, kick the watchdog into action
+  std::condition_variable result_wakeup_;
+
   // track how much time the worker thread is taking during a state machine step
   std::thread watchdog_;
 
   // control in the worker thread
   std::thread         worker_;
   std::mutex          master_command_mutex_;
-  std::atomic< bool > has_new_command_;
+  std::atomic< bool > worker_parked_;
   std::atomic< bool > worker_ready_;
 
-  // track time in state machine step, process timeouts on the watchdog thread
-  std::mutex         time_mutex_;
-  double             last_worker_response_;
-  double             timeout_;
-  BaseRate< TClock > rate_;
+  // completion pacing at the runner frequency
+  bool         paced_          = false;
+  bool         first_delivery_ = true;
+  DeliveryRate delivery_rate_;
+
+  // time between timeout handler calls while unresponsive
+  std::chrono::nanoseconds timeout_repeat_;
 
   // process the results on the watchdog thread
   std::mutex          result_mutex_;
   TResult             last_worker_result_;
   std::atomic< bool > has_new_result_;
-
-  // the command. Candidate for std::variant
-  TCommandParameter command_;
-
-  bool shutdown_desired_;
 };
-}  // namespace fsm
\ No newline at end of file
+}  // namespace fsm
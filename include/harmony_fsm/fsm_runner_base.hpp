@@ -0,0 +1,684 @@
+/**
+ * @file fsm_runner_base.hpp
+ * @brief Common handler and command plumbing of the Finite State Machine runners
+ * @date 2026-10-16
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "finite_state_machine.hpp"
+#include "fsm_command_queue.hpp"
+#include "fsm_timeout_supervisor.hpp"
+
+namespace fsm
+{
+using UnusedCommandParameter = int;
+
+/**
+ * @brief Handler API shared by the runners: execution functions, completion, pre-execution, timeout and exception
+ * handlers, and the command queue that kicks the state functions. Derived runners decide where the state
+ * functions run. Timeouts are supervised by the TimeoutSupervisor shared by all runners on TClock. Each step reads
+ * TClock once and publishes the time through FSMCycleBaseClock< TClock > to the functions it runs.
+ * Set the functions and handlers before calling start.
+ */
+template < typename TEvent, typename TState, typename TCommandParameter, typename TResult, typename TClock >
+class FiniteStateMachineRunnerBase : public FiniteStateMachine< TEvent, TState >
+{
+ public:
+  /**
+   * @brief Construct a new Finite State Machine Runner Base object, single function for execution by default
+   *
+   * @param fsm_table Valid transition table
+   * @param init_state Initial state
+   * @param init_result The initial result to process when kicked by the completion_handler at startup
+   * @param exec_fun Single function through which all states execute
+   * @param completion_handler Function through which execution results are processed. Kick into new states here
+   * @param pre_exec_fun Function to run before executing any state function
+   * @param timeout_handler If an execution function takes longer that timeout (see setTimeout), execute this function
+   * @param exception_handler If an exception is thrown during an execution function, it will propogate to this handler
+   */
+  FiniteStateMachineRunnerBase( std::vector< EventTableEntry< TEvent, TState > >     fsm_table,
+                                TState                                               init_state,
+                                TResult                                              init_result,
+                                std::function< TResult( const TCommandParameter* ) > exec_fun,
+                                std::function< void( const TResult& ) >              completion_handler,
+                                std::function< void( const TCommandParameter* ) >    pre_exec_fun,
+                                std::function< void( double ) >                      timeout_handler,
+                                std::function< void( const std::exception& ) >       exception_handler )
+    : FiniteStateMachine< TEvent, TState >( fsm_table, init_state )
+    , execute_fun_( exec_fun )
+    , completion_handler_fun_( completion_handler )
+    , pre_exec_fun_( pre_exec_fun )
+    , timeout_handler_fun_( timeout_handler )
+    , exception_handler_fun_( exception_handler )
+    , init_result_( init_result )
+  {
+  }
+
+  /**
+   * @brief Construct a new Finite State Machine Runner Base object, utilizes a map of states to functions
+   *
+   * @param fsm_table Valid transition table
+   * @param init_state Initial state
+   * @param init_result The initial result to process when kicked by the completion_handler
+   * @param exec_fun_map A map of TState vs functions to execute for each state
+   * @param completion_handler Function through which execution results are processed. Kick into new states here
+   * @param pre_exec_fun Function to run before executing any state function
+   * @param timeout_handler If an execution function takes longer that timeout (see setTimeout), execute this function
+   * @param exception_handler If an exception is thrown during an execution function, it will propogate to this handler
+   */
+  FiniteStateMachineRunnerBase( std::vector< EventTableEntry< TEvent, TState > >                         fsm_table,
+                                TState                                                                   init_state,
+                                TResult                                                                  init_result,
+                                std::map< TState, std::function< TResult( const TCommandParameter* ) > > exec_fun_map,
+                                std::function< void( const TResult& ) >                                  completion_handler,
+                                std::function< void( const TCommandParameter* ) >                        pre_exec_fun,
+                                std::function< void( double ) >                                          timeout_handler,
+                                std::function< void( const std::exception& ) >                           exception_handler )
+    : FiniteStateMachine< TEvent, TState >( fsm_table, init_state )
+    , completion_handler_fun_( completion_handler )
+    , pre_exec_fun_( pre_exec_fun )
+    , timeout_handler_fun_( timeout_handler )
+    , exception_handler_fun_( exception_handler )
+    , execute_fun_map_( exec_fun_map )
+    , init_result_( init_result )
+  {
+  }
+
+  FiniteStateMachineRunnerBase( const FiniteStateMachineRunnerBase& ) = delete;
+  void operator=( const FiniteStateMachineRunnerBase& ) = delete;
+
+  virtual ~FiniteStateMachineRunnerBase() = default;
+
+  /**
+   * @brief Starts running, the initial result is handed to the completion handler first
+   */
+  virtual void start() = 0;
+
+  /**
+   * @brief Issues stop request
+   */
+  virtual void stop() = 0;
+
+  /**
+   * @brief Returns whether threads are currently attempting to stop 
+   * 
+   * @return true Stop has been requested 
+   * @return false Stop has not been requested
+   */
+  bool stopping() const
+  {
+    return shutdown_desired_;
+  }
+
+  /**
+   * @brief Set the execution function map. 
+   * 
+   * @param execute_fun_map map of functions by state
+   */
+  void setExecFunctionMap( std::map< TState, std::function< TResult( const TCommandParameter* ) > > execute_fun_map )
+  {
+    execute_fun_map_ = execute_fun_map;
+  }
+
+  /**
+   * @brief Set the execution function to run in every state
+   * 
+   * @param execute_fun Execution function to run in every state
+   */
+  void setExecFunction( std::function< TResult( const TCommandParameter* ) > execute_fun )
+  {
+    execute_fun_ = execute_fun;
+  }
+
+  /**
+   * @brief Set the function to execute prior to that state function
+   * 
+   * @param pre_exec_fun Function to execute prior to that state function
+   */
+  void setPreExecFunction( std::function< void( const TCommandParameter* ) > pre_exec_fun )
+  {
+    pre_exec_fun_ = pre_exec_fun;
+  }
+
+  /**
+   * @brief Set the handler to process the results of execution functions
+   * 
+   * @param completion_handler Handler to process the results of execution functions
+   */
+  void setCompletionHandler( std::function< void( const TResult& ) > completion_handler )
+  {
+    completion_handler_fun_ = completion_handler;
+  }
+
+  /**
+   * @brief Set the handler to process exceptions thrown during execution functions
+   * 
+   * @param exception_handler Handler to process exceptions thrown during execution functions
+   */
+  void setExceptionHandler( std::function< void( const std::exception& ) > exception_handler )
+  {
+    exception_handler_fun_ = exception_handler;
+  }
+
+  /**
+   * @brief Set the handler to process timeouts as defined by setTimeout. On a running runner supervision is
+   * re-armed from the last response; not from the timeout handler itself.
+   * 
+   * @param exception_handler Handler to process timeouts as defined by setTimeout
+   */
+  void setTimeoutHandler( std::function< void( const double ) > timeout_handler )
+  {
+    changeTimeout( [&]() { timeout_handler_fun_ = timeout_handler; } );
+  }
+
+  /**
+   * @brief Set the depth of the command queue and what happens when it overflows. The default, a depth of one
+   * with OverflowPolicy::COALESCE, runs the newest command once. Call before start.
+   *
+   * @param depth Number of commands that can be pending
+   * @param policy What updateFSM and doEventAndExecute do when the queue is full
+   * @throw std::invalid_argument if depth is zero
+   */
+  void setCommandQueue( std::size_t depth, OverflowPolicy policy )
+  {
+    commands_        = std::make_unique< BoundedCommandQueue< QueuedCommand > >( depth );
+    overflow_policy_ = policy;
+  }
+
+  /**
+   * @brief Number of commands discarded by the overflow policy of the command queue
+   */
+  std::size_t droppedCommands() const
+  {
+    return commands_->dropped();
+  }
+
+  /**
+   * @brief Set the timeout in sec before invoking the timeout handler. On a running runner supervision is
+   * re-armed from the last response.
+   * 
+   * @param seconds seconds
+   */
+  void setTimeout( double seconds )
+  {
+    setTimeout( toNanoseconds( seconds ) );
+  }
+
+  /**
+   * @brief Set the timeout before invoking the timeout handler, see setTimeout( double ). Supervised as integer
+   * nanoseconds, a duration beyond their range never times out.
+   *
+   * @param timeout std::chrono duration
+   */
+  template < typename TRep, typename TPeriod >
+  void setTimeout( std::chrono::duration< TRep, TPeriod > timeout )
+  {
+    const std::chrono::nanoseconds checked = toNanoseconds( timeout );
+    changeTimeout( [&]() {
+      std::unique_lock< std::mutex > lock( time_mutex_ );
+      timeout_ = checked;
+    } );
+  }
+
+  /**
+   * @brief Time of the current step, or of the last one between steps. State functions and the timers they
+   * check read the same time through FSMCycleBaseClock< TClock >.
+   */
+  double cycleTime() const
+  {
+    return toSeconds( cycle_time_.load( std::memory_order_relaxed ) );
+  }
+
+  /**
+   * @brief Execute a state machine transition, serialized with the runner picking its state function
+   *
+   * @param trigger
+   * @return true if the state change was executed successfully
+   */
+  bool doEvent( const TEvent& trigger ) override
+  {
+    std::unique_lock< std::mutex > lock( state_mutex_ );
+    return transition( trigger );
+  }
+
+  /**
+   * @brief Checks whether the current transition event could yield a new state, under the state lock
+   *
+   * @param trigger
+   * @param next_state The next state given this transition
+   * @return true if the transition is valid from the current state
+   */
+  bool isValid( const TEvent& trigger, TState& next_state ) const override
+  {
+    std::unique_lock< std::mutex > lock( state_mutex_ );
+    return FiniteStateMachine< TEvent, TState >::isValid( trigger, next_state );
+  }
+
+  /**
+   * @brief Applies a span of events under the state lock, see FiniteStateMachine::doEvents. Hides the unlocked
+   * base version, which must not be called through a FiniteStateMachine reference while the runner runs.
+   *
+   * @param first First event
+   * @param last One past the last event
+   * @param policy How invalid events are handled, see BatchPolicy
+   * @param states_out Optional, last - first states, the state after each applied event
+   * @return BatchResult< TState > events applied or index of the offending event, and the final state
+   */
+  BatchResult< TState > doEvents( const TEvent* first,
+                                  const TEvent* last,
+                                  BatchPolicy   policy     = BatchPolicy::STOP_AT_INVALID,
+                                  TState*       states_out = nullptr )
+  {
+    std::unique_lock< std::mutex > lock( state_mutex_ );
+    return FiniteStateMachine< TEvent, TState >::doEvents( first, last, policy, states_out );
+  }
+
+  TState getCurrentState() const override
+  {
+    std::unique_lock< std::mutex > lock( state_mutex_ );
+    return FiniteStateMachine< TEvent, TState >::getCurrentState();
+  }
+
+  /**
+   * @brief Steps the state machine and if successfully transitioned, executes the function of the state it
+   * transitioned to, even if later transitions happen before the command runs
+   * 
+   * @param trigger Event trigger
+   * @param command Parameter object to pass to execution function
+   * @return true Returns true if transition was successful
+   * @return false Returns false if transition was not successful
+   */
+  bool doEventAndExecute( const TEvent& trigger, TCommandParameter&& command )
+  {
+    QueuedCommand queued;
+    queued.HasParameter = true;
+    queued.Parameter    = std::forward< TCommandParameter >( command );
+    return transitionAndEnqueue( trigger, std::move( queued ) );
+  }
+
+  /**
+   * @brief Steps the state machine and if successfully transitioned, executes the function of the state it
+   * transitioned to, reusing the last command parameters
+   * 
+   * @param trigger Event trigger
+   * @return true Returns true if transition was successful
+   * @return false Returns false if transition was not successful
+   */
+  bool doEventAndExecute( const TEvent& trigger )
+  {
+    return transitionAndEnqueue( trigger, QueuedCommand() );
+  }
+
+  /**
+   * @brief Kicks the runner into execution function and passes the given command parameters
+   * 
+   * @param command Parameter object to pass to execution function
+   * @return true if the command was queued, false if the overflow policy dropped it
+   */
+  bool updateFSM( TCommandParameter&& command )
+  {
+    QueuedCommand queued;
+    queued.HasParameter = true;
+    queued.Parameter    = std::forward< TCommandParameter >( command );
+    return enqueue( std::move( queued ) );
+  }
+
+  /**
+   * @brief Kicks the runner into execution function, reusing the last command parameters. Under
+   * OverflowPolicy::COALESCE a kick is merged into a pending command, which starts after this call anyway and
+   * carries the newest parameters. Under the other policies the kick is queued like any command.
+   * 
+   * @return true if the kick was queued or merged, false if the overflow policy dropped it
+   */
+  bool updateFSM()
+  {
+    if ( overflow_policy_ == OverflowPolicy::COALESCE && !commands_->empty() )
+    {
+      return true;
+    }
+
+    return enqueue( QueuedCommand() );
+  }
+
+ protected:
+  // a queued kick, without a parameter the state function reuses the last one. Commands queued with a
+  // transition run the function of the state they transitioned to, others that of the state when they run.
+  struct QueuedCommand
+  {
+    bool              HasParameter = false;
+    TCommandParameter Parameter;
+    bool              HasState = false;
+    TState            State    = TState();
+  };
+
+  /**
+   * @brief Called after a command was queued, from the producing thread. The queue store is ordered before the
+   * call by a full fence.
+   */
+  virtual void notifyCommand() = 0;
+
+  bool popCommand( QueuedCommand& queued )
+  {
+    return commands_->tryPop( queued );
+  }
+
+  bool hasPendingCommand() const
+  {
+    return !commands_->empty();
+  }
+
+  /**
+   * @brief Runs a popped command: picks the function of the state recorded with the command, or else of the
+   * current state under the state lock, then runs the pre-execution and state functions unlocked. The time of the
+   * step is published through FSMCycleBaseClock< TClock > until the result is delivered. Exceptions propagate to
+   * the caller.
+   *
+   * @param queued Command popped from the queue
+   * @param now Time of the step, read once by the runner
+   * @param deliver Receives the result of the state function, records the response as the runner needs it, see
+   * markResponse
+   * @return true if a state function ran
+   */
+  template < typename TDeliver >
+  bool executeCommand( QueuedCommand& queued, std::chrono::nanoseconds now, TDeliver&& deliver )
+  {
+    cycle_time_.store( now, std::memory_order_relaxed );
+
+    const std::function< TResult( const TCommandParameter* ) >* execution_function = nullptr;
+    if ( execute_fun_ != nullptr )
+    {
+      execution_function = &execute_fun_;
+    }
+    else
+    {
+      TState state = queued.State;
+      if ( !queued.HasState )
+      {
+        std::unique_lock< std::mutex > lock( state_mutex_ );
+        state = FiniteStateMachine< TEvent, TState >::getCurrentState();
+      }
+
+      auto it_fun = execute_fun_map_.find( state );
+      if ( it_fun != end( execute_fun_map_ ) )
+      {
+        execution_function = &it_fun->second;
+      }
+    }
+
+    if ( queued.HasParameter )
+    {
+      active_command_ = std::move( queued.Parameter );
+    }
+
+    if ( execution_function == nullptr )
+    {
+      return false;
+    }
+
+    typename FSMCycleBaseClock< TClock >::Scope snapshot( now );
+    if ( pre_exec_fun_ )
+    {
+      pre_exec_fun_( &active_command_ );
+    }
+
+    if ( shutdown_desired_ )
+    {
+      return false;
+    }
+
+    TResult res = ( *execution_function )( &active_command_ );
+    deliver( std::move( res ) );
+    return true;
+  }
+
+  /**
+   * @brief Records a response of the state functions and re-arms the timeout deadline, an atomic store
+   *
+   * @param now Time of the response since the TClock epoch
+   */
+  void markResponse( std::chrono::nanoseconds now )
+  {
+    std::unique_lock< std::mutex > lock( time_mutex_ );
+    last_worker_response_ = now;
+    if ( timeout_subscription_ )
+    {
+      timeout_subscription_->Deadline.store( last_worker_response_ + timeout_, std::memory_order_relaxed );
+    }
+  }
+
+  /**
+   * @brief Starts supervising the timeout. Nothing is supervised without a timeout handler or with an infinite
+   * timeout, until setTimeoutHandler or setTimeout re-arm it.
+   *
+   * @param repeat Time between timeout handler calls while the state functions stay unresponsive
+   * @param restart Measure the timeout from now rather than from the last response
+   */
+  void superviseTimeout( std::chrono::nanoseconds repeat, bool restart = true )
+  {
+    releaseTimeout();
+    if ( restart )
+    {
+      markResponse( TClock::sinceEpoch() );
+    }
+
+    {
+      std::unique_lock< std::mutex > lock( time_mutex_ );
+      supervising_       = true;
+      supervised_repeat_ = repeat;
+      if ( !timeout_handler_fun_ || timeout_ == std::chrono::nanoseconds::max() )
+      {
+        return;
+      }
+    }
+
+    auto subscription     = std::make_shared< typename TimeoutSupervisor< TClock >::Subscription >();
+    subscription->Repeat  = repeat;
+    subscription->Expired = [this]() { checkTimeout(); };
+    {
+      std::unique_lock< std::mutex > lock( time_mutex_ );
+      subscription->Deadline = last_worker_response_ + timeout_;
+      timeout_subscription_ = subscription;
+    }
+    TimeoutSupervisor< TClock >::shared().add( subscription );
+  }
+
+  /**
+   * @brief Stops supervising the timeout, once this returns the timeout handler is not running unless called
+   * from it
+   */
+  void releaseTimeout()
+  {
+    std::shared_ptr< typename TimeoutSupervisor< TClock >::Subscription > subscription;
+    {
+      std::unique_lock< std::mutex > lock( time_mutex_ );
+      supervising_ = false;
+      subscription = std::move( timeout_subscription_ );
+      timeout_subscription_.reset();
+    }
+
+    if ( subscription )
+    {
+      TimeoutSupervisor< TClock >::shared().remove( subscription );
+    }
+  }
+
+  /**
+   * @brief Invokes the timeout handler if the state functions have not responded within the timeout, at the
+   * time published by the supervisor
+   */
+  void checkTimeout()
+  {
+    if ( timeout_handler_fun_ )
+    {
+      std::chrono::nanoseconds last_response{ 0 };
+      {
+        std::unique_lock< std::mutex > lock( time_mutex_ );
+        if ( ( FSMCycleBaseClock< TClock >::sinceEpoch() - last_worker_response_ ) < timeout_ )
+        {
+          return;
+        }
+        last_response = last_worker_response_;
+      }
+      timeout_handler_fun_( toSeconds( last_response ) );
+    }
+  }
+
+  /**
+   * @brief Applies a change of the timeout or its handler, re-arming supervision if it is running. The handler is
+   * not running while it changes.
+   */
+  template < typename TChange >
+  void changeTimeout( TChange&& change )
+  {
+    bool                     supervising = false;
+    std::chrono::nanoseconds repeat{ 0 };
+    {
+      std::unique_lock< std::mutex > lock( time_mutex_ );
+      supervising = supervising_;
+      repeat      = supervised_repeat_;
+    }
+
+    if ( supervising )
+    {
+      releaseTimeout();
+    }
+    change();
+    if ( supervising )
+    {
+      superviseTimeout( repeat, false );
+    }
+  }
+
+  void handleException( const std::exception& ex )
+  {
+    if ( exception_handler_fun_ )
+    {
+      exception_handler_fun_( ex );
+    }
+  }
+
+  std::function< TResult( const TCommandParameter* ) >                     execute_fun_            = nullptr;
+  std::function< void( const TResult& ) >                                  completion_handler_fun_ = nullptr;
+  std::function< void( const TCommandParameter* ) >                        pre_exec_fun_           = nullptr;
+  std::function< void( double ) >                                          timeout_handler_fun_    = nullptr;
+  std::function< void( const std::exception& ) >                           exception_handler_fun_  = nullptr;
+  std::map< TState, std::function< TResult( const TCommandParameter* ) > > execute_fun_map_;
+
+  // handed to the completion handler when starting
+  TResult init_result_;
+
+  // the commands. Candidate for std::variant. Each popped parameter is moved into active_command_, the state
+  // functions run on it without holding a lock
+  std::unique_ptr< BoundedCommandQueue< QueuedCommand > > commands_        = std::make_unique< BoundedCommandQueue< QueuedCommand > >( 1 );
+  OverflowPolicy                                          overflow_policy_ = OverflowPolicy::COALESCE;
+  TCommandParameter                                       active_command_;
+
+  // guards the current state against the runner picking a state function
+  mutable std::mutex state_mutex_;
+
+  // keeps the commands of doEventAndExecute in the order of their transitions, never held while notifying
+  std::mutex submit_mutex_;
+
+  // track time in state machine step, for timeout supervision, in nanoseconds since the TClock epoch. A timeout
+  // of nanoseconds::max() is never supervised
+  std::mutex               time_mutex_;
+  std::chrono::nanoseconds last_worker_response_ = TClock::sinceEpoch();
+  std::chrono::nanoseconds timeout_              = std::chrono::nanoseconds::max();
+
+  // start of the current or last step
+  std::atomic< std::chrono::nanoseconds > cycle_time_{ TClock::sinceEpoch() };
+
+  // deadline held by the shared supervisor while running, re-armed with supervised_repeat_ on changes
+  std::shared_ptr< typename TimeoutSupervisor< TClock >::Subscription > timeout_subscription_;
+  bool                                                                  supervising_       = false;
+  std::chrono::nanoseconds                                              supervised_repeat_{ std::chrono::seconds( 1 ) };
+
+  std::atomic< bool > shutdown_desired_{ false };
+
+ private:
+  // doEvent without the virtual isValid, which takes the state lock itself. Call with state_mutex_ held.
+  bool transition( const TEvent& trigger )
+  {
+    TState next_state;
+    if ( FiniteStateMachine< TEvent, TState >::isValid( trigger, next_state ) )
+    {
+      this->current_state_ = next_state;
+      return true;
+    }
+
+    return false;
+  }
+
+  bool enqueue( QueuedCommand&& queued )
+  {
+    const bool res = commands_->push( std::move( queued ), overflow_policy_ );
+    notifyQueued();
+    return res;
+  }
+
+  // records the state transitioned to in the command, in the critical section of the transition
+  bool transitionAndEnqueue( const TEvent& trigger, QueuedCommand&& queued )
+  {
+    {
+      std::unique_lock< std::mutex > submit( submit_mutex_ );
+      {
+        std::unique_lock< std::mutex > lock( state_mutex_ );
+        if ( !transition( trigger ) )
+        {
+          return false;
+        }
+        queued.HasState = true;
+        queued.State    = this->current_state_;
+      }
+      commands_->push( std::move( queued ), overflow_policy_ );
+    }
+
+    // unlocked, the inline runner runs the command and the handlers it calls right here
+    notifyQueued();
+    return true;
+  }
+
+  void notifyQueued()
+  {
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    notifyCommand();
+  }
+};
+
+}  // namespace fsm
@@ -0,0 +1,68 @@
+/**
+ * @file fsm_shared_table.hpp
+ * @brief Harmony FSM helpers for transition tables shared between machines
+ * @date 2026-10-16
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#pragma once
+
+#include <memory>
+#include <utility>
+
+namespace fsm
+{
+/**
+ * @brief Builds a refcounted, immutable transition table to share between many machine instances
+ *
+ * @tparam TTable FiniteStateMachine::TransitionMap, DenseTransitionTable, ...
+ * @param args Table constructor arguments
+ * @return std::shared_ptr< const TTable >
+ */
+template < typename TTable, typename... TArgs >
+std::shared_ptr< const TTable > makeSharedTable( TArgs&&... args )
+{
+  return std::make_shared< const TTable >( std::forward< TArgs >( args )... );
+}
+
+/**
+ * @brief Lends a table with a longer lifetime than its machines (static data, owner object, ...). No reference
+ * count is kept, the caller guarantees the table outlives every machine built from the returned pointer.
+ *
+ * @tparam TTable FiniteStateMachine::TransitionMap, DenseTransitionTable, ...
+ * @param table Table to lend
+ * @return std::shared_ptr< const TTable > non-owning pointer to table
+ */
+template < typename TTable >
+std::shared_ptr< const TTable > borrowTable( const TTable& table )
+{
+  return std::shared_ptr< const TTable >( std::shared_ptr< const TTable >(), &table );
+}
+
+}  // namespace fsm
@@ -0,0 +1,265 @@
+/**
+ * @file fsm_sleep_policy.hpp
+ * @brief Harmony FSM sleep policies for integer rates
+ * @date 2026-10-16
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <type_traits>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <immintrin.h>
+#endif
+
+#ifdef __linux__
+#include <cerrno>
+#include <time.h>
+#endif
+
+#include "fsm_clocks.hpp"
+
+namespace fsm
+{
+/**
+ * @brief Sleeps with std::this_thread::sleep_until, portable to any std::chrono clock
+ */
+struct ChronoSleeper
+{
+  template < typename TChronoClock, typename TDuration >
+  void sleepUntil( const std::chrono::time_point< TChronoClock, TDuration >& deadline )
+  {
+    std::this_thread::sleep_until( deadline );
+  }
+};
+
+/**
+ * @brief Sleeps through ClockTraits< TClock > for the time left until the deadline, so rates on virtual and cycle
+ * clocks advance or wait on their clock instead of polling std::chrono. The sleeper of BaseRate.
+ *
+ * @tparam TClock FSM clock the deadlines are measured with
+ */
+template < typename TClock >
+struct ClockSleeper
+{
+  template < typename TChronoClock, typename TDuration >
+  void sleepUntil( const std::chrono::time_point< TChronoClock, TDuration >& deadline )
+  {
+    const auto left = std::chrono::duration_cast< std::chrono::nanoseconds >( deadline.time_since_epoch() ) - TClock::sinceEpoch();
+    if ( left > std::chrono::nanoseconds::zero() )
+    {
+      ClockTraits< TClock >::sleepFor( left );
+    }
+  }
+};
+
+#ifdef __linux__
+/**
+ * @brief Sleeps with clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME ) on the deadline itself, so preemption
+ * between reading the clock and going to sleep does not delay the wakeup. Resumes after signals. Requires
+ * std::chrono::steady_clock, which is CLOCK_MONOTONIC on Linux.
+ */
+struct AbsoluteMonotonicSleeper
+{
+  template < typename TChronoClock, typename TDuration >
+  void sleepUntil( const std::chrono::time_point< TChronoClock, TDuration >& deadline )
+  {
+    static_assert( std::is_same< TChronoClock, std::chrono::steady_clock >::value, "CLOCK_MONOTONIC deadlines need std::chrono::steady_clock" );
+
+    const auto      since_epoch = std::chrono::duration_cast< std::chrono::nanoseconds >( deadline.time_since_epoch() );
+    struct timespec request;
+    request.tv_sec  = static_cast< time_t >( since_epoch.count() / 1000000000 );
+    request.tv_nsec = static_cast< long >( since_epoch.count() % 1000000000 );
+    if ( request.tv_sec < 0 || request.tv_nsec < 0 )
+    {
+      return;
+    }
+
+    while ( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &request, nullptr ) == EINTR )
+    {
+    }
+  }
+};
+#endif
+
+/**
+ * @brief Tells the CPU that the thread is busy waiting, saving power and yielding the core to a hyperthread
+ */
+inline void cpuRelax()
+{
+#if defined( __x86_64__ ) || defined( __i386__ )
+  _mm_pause();
+#elif defined( __aarch64__ ) || defined( __arm__ )
+  __asm__ __volatile__( "yield" );
+#else
+  std::this_thread::yield();
+#endif
+}
+
+/**
+ * @brief Sleeps with TSleeper until shortly before the deadline, then busy waits for it with cpuRelax. The margin
+ * kept for spinning starts at zero and is learned from the oversleep of the coarse sleeps, a high estimate of mean
+ * plus four mean deviations. It is capped by the spin limit, the CPU time a cycle may burn. A limit of zero only
+ * sleeps. Sleeps shorter than the margin only spin, each of them decays the estimate, so a margin that outgrew the
+ * period shrinks until a coarse sleep measures the oversleep again rather than spinning for good. A deadline already past on entry returns at once and
+ * is counted as overdue, not as wakeup error. Statistics are plain members, read them from the sleeping thread.
+ *
+ * @tparam TSleeper Policy for the coarse sleep
+ */
+template < typename TSleeper = ChronoSleeper >
+class HybridSpinSleeper
+{
+ public:
+  struct WakeupStats
+  {
+    std::size_t              Wakeups = 0;     // sleeps with a deadline still ahead, the errors cover only these
+    std::size_t              Overdue = 0;     // calls with a deadline already past, e.g. after an overrun
+    std::chrono::nanoseconds MeanError{ 0 };  // wakeup after the deadline
+    std::chrono::nanoseconds MaxError{ 0 };
+    std::chrono::nanoseconds Spun{ 0 };       // total busy waiting
+    std::chrono::nanoseconds Margin{ 0 };     // current early wakeup margin
+  };
+
+  /**
+   * @brief Construct a new Hybrid Spin Sleeper object
+   *
+   * @param spin_limit Longest busy wait per sleep
+   */
+  explicit HybridSpinSleeper( std::chrono::nanoseconds spin_limit = std::chrono::microseconds( 200 ) )
+    : spin_limit_( spin_limit )
+    , margin_( std::chrono::nanoseconds::zero() )
+  {
+  }
+
+  void setSpinLimit( std::chrono::nanoseconds spin_limit )
+  {
+    spin_limit_ = spin_limit;
+    margin_     = std::min( margin_, spin_limit_ );
+  }
+
+  template < typename TChronoClock, typename TDuration >
+  void sleepUntil( const std::chrono::time_point< TChronoClock, TDuration >& deadline )
+  {
+    const auto entry = TChronoClock::now();
+    if ( entry >= deadline )
+    {
+      stats_.Overdue++;
+      return;  // nothing to wait for, not a wakeup
+    }
+
+    const auto wake_target = deadline - margin_;
+    if ( entry < wake_target )
+    {
+      coarse_.sleepUntil( wake_target );
+      learn( std::chrono::duration_cast< std::chrono::nanoseconds >( TChronoClock::now() - wake_target ) );
+    }
+    else
+    {
+      decay();
+    }
+
+    auto now        = TChronoClock::now();
+    auto spin_start = now;
+    while ( now < deadline )
+    {
+      cpuRelax();
+      now = TChronoClock::now();
+    }
+
+    const auto error = std::chrono::duration_cast< std::chrono::nanoseconds >( now - deadline );
+    stats_.Wakeups++;
+    total_error_ += error;
+    stats_.MeanError = total_error_ / stats_.Wakeups;
+    stats_.MaxError  = std::max( stats_.MaxError, error );
+    if ( spin_start < deadline )
+    {
+      stats_.Spun += std::chrono::duration_cast< std::chrono::nanoseconds >( deadline - spin_start );  // not the overshoot
+    }
+  }
+
+  WakeupStats stats() const
+  {
+    WakeupStats res = stats_;
+    res.Margin      = margin_;
+    return res;
+  }
+
+  void resetStats()
+  {
+    stats_       = WakeupStats();
+    total_error_ = std::chrono::nanoseconds::zero();
+  }
+
+ private:
+  // tracks the oversleep of coarse sleeps and keeps a margin that covers nearly all of them
+  void learn( std::chrono::nanoseconds oversleep )
+  {
+    const double sample = static_cast< double >( oversleep.count() );
+    if ( !learned_ )
+    {
+      oversleep_mean_      = sample;
+      oversleep_deviation_ = sample / 2;
+      learned_             = true;
+    }
+    oversleep_mean_ += ( sample - oversleep_mean_ ) / 16;
+    oversleep_deviation_ += ( std::abs( sample - oversleep_mean_ ) - oversleep_deviation_ ) / 16;
+    updateMargin();
+  }
+
+  // a spin-only sleep measures no oversleep, shrink the estimate so a coarse sleep eventually probes it again
+  void decay()
+  {
+    oversleep_mean_ -= oversleep_mean_ / 16;
+    oversleep_deviation_ -= oversleep_deviation_ / 16;
+    updateMargin();
+  }
+
+  void updateMargin()
+  {
+    const auto margin = std::chrono::nanoseconds( static_cast< long long >( oversleep_mean_ + 4 * oversleep_deviation_ ) );
+    margin_           = std::max( std::chrono::nanoseconds::zero(), std::min( margin, spin_limit_ ) );
+  }
+
+  TSleeper                 coarse_;
+  std::chrono::nanoseconds spin_limit_;
+  std::chrono::nanoseconds margin_;
+  bool                     learned_             = false;
+  double                   oversleep_mean_      = 0;
+  double                   oversleep_deviation_ = 0;
+  WakeupStats              stats_;
+  std::chrono::nanoseconds total_error_{ 0 };
+};
+
+}  // namespace fsm
@@ -0,0 +1,298 @@
+/**
+ * @file fsm_thread_pool.hpp
+ * @brief Harmony FSM work-stealing thread pool
+ * @date 2026-10-16
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fsm
+{
+/**
+ * @class WorkStealingThreadPool
+ * @brief Fixed set of worker threads, each with its own task queue. Workers run their own queue newest first and
+ * steal the oldest task of other queues when idle, which balances uneven work without a central queue.
+ */
+class WorkStealingThreadPool
+{
+ public:
+  /**
+   * @brief Construct a new Work Stealing Thread Pool object
+   *
+   * @param thread_count Number of worker threads, one per core by default
+   */
+  explicit WorkStealingThreadPool( std::size_t thread_count = defaultThreadCount() )
+  {
+    thread_count = thread_count == 0 ? 1 : thread_count;
+    for ( std::size_t i = 0; i < thread_count; i++ )
+    {
+      queues_.emplace_back( new WorkerQueue() );
+    }
+
+    for ( std::size_t i = 0; i < thread_count; i++ )
+    {
+      threads_.emplace_back( &WorkStealingThreadPool::workerThread, this, i );
+    }
+  }
+
+  WorkStealingThreadPool( const WorkStealingThreadPool& ) = delete;
+  void operator=( const WorkStealingThreadPool& ) = delete;
+
+  /**
+   * @brief Runs the tasks still queued, then joins the workers
+   */
+  ~WorkStealingThreadPool()
+  {
+    {
+      std::unique_lock< std::mutex > lock( wake_mutex_ );
+      shutdown_desired_ = true;
+    }
+    wake_.notify_all();
+
+    for ( auto& thread : threads_ )
+    {
+      thread.join();
+    }
+  }
+
+  static std::size_t defaultThreadCount()
+  {
+    const std::size_t cores = std::thread::hardware_concurrency();
+    return cores == 0 ? 1 : cores;
+  }
+
+  std::size_t size() const
+  {
+    return threads_.size();
+  }
+
+  /**
+   * @brief Queues a task. Called from a worker the task lands on that worker's own queue, otherwise queues are
+   * filled round robin. Tasks must not throw, see parallelFor for work that can.
+   *
+   * @param task Task to run
+   */
+  void submit( std::function< void() > task )
+  {
+    const std::size_t home = workerIndex() < queues_.size() ? workerIndex() : next_queue_++ % queues_.size();
+
+    pending_++;
+    {
+      std::unique_lock< std::mutex > lock( queues_[home]->mutex );
+      queues_[home]->tasks.push_back( std::move( task ) );
+    }
+
+    if ( sleeping_ > 0 )
+    {
+      std::unique_lock< std::mutex > lock( wake_mutex_ );
+      wake_.notify_one();
+    }
+  }
+
+  /**
+   * @brief Runs task( i ) for every i in [0, count) across the pool and waits for all of them. The calling thread
+   * runs queued tasks while it waits. The first exception thrown by a task is rethrown here.
+   *
+   * @param count Number of task invocations
+   * @param task Task taking the invocation index
+   */
+  void parallelFor( std::size_t count, const std::function< void( std::size_t ) >& task )
+  {
+    struct Group
+    {
+      std::atomic< std::size_t > remaining;
+      std::mutex                 mutex;
+      std::condition_variable    done;
+      std::exception_ptr         error;
+    };
+
+    auto group       = std::make_shared< Group >();
+    group->remaining = count;
+
+    for ( std::size_t i = 0; i < count; i++ )
+    {
+      submit( [group, &task, i]() {
+        try
+        {
+          task( i );
+        }
+        catch ( ... )
+        {
+          std::unique_lock< std::mutex > lock( group->mutex );
+          if ( !group->error )
+          {
+            group->error = std::current_exception();
+          }
+        }
+
+        if ( --group->remaining == 0 )
+        {
+          std::unique_lock< std::mutex > lock( group->mutex );
+          group->done.notify_all();
+        }
+      } );
+    }
+
+    while ( group->remaining > 0 )
+    {
+      if ( !runPendingTask( workerIndex() < queues_.size() ? workerIndex() : 0 ) )
+      {
+        std::unique_lock< std::mutex > lock( group->mutex );
+        group->done.wait_for( lock, std::chrono::milliseconds( 1 ), [&]() { return group->remaining == 0; } );
+      }
+    }
+
+    if ( group->error )
+    {
+      std::rethrow_exception( group->error );
+    }
+  }
+
+ private:
+  // separately allocated and padded so that neighbouring queues do not share a cache line
+  struct WorkerQueue
+  {
+    std::mutex                           mutex;
+    std::deque< std::function< void() > > tasks;
+    char                                 padding[64];
+  };
+
+  struct WorkerIdentity
+  {
+    const WorkStealingThreadPool* pool  = nullptr;
+    std::size_t                   index = 0;
+  };
+
+  static WorkerIdentity& currentWorker()
+  {
+    static thread_local WorkerIdentity identity;
+    return identity;
+  }
+
+  /**
+   * @brief Index of the calling thread in this pool, size() for threads outside of it
+   */
+  std::size_t workerIndex() const
+  {
+    return currentWorker().pool == this ? currentWorker().index : queues_.size();
+  }
+
+  bool popOwn( std::size_t index, std::function< void() >& task )
+  {
+    std::unique_lock< std::mutex > lock( queues_[index]->mutex );
+    if ( queues_[index]->tasks.empty() )
+    {
+      return false;
+    }
+
+    task = std::move( queues_[index]->tasks.back() );
+    queues_[index]->tasks.pop_back();
+    return true;
+  }
+
+  bool steal( std::size_t thief, std::function< void() >& task )
+  {
+    for ( std::size_t offset = 1; offset <= queues_.size(); offset++ )
+    {
+      auto&                          victim = *queues_[( thief + offset ) % queues_.size()];
+      std::unique_lock< std::mutex > lock( victim.mutex );
+      if ( !victim.tasks.empty() )
+      {
+        task = std::move( victim.tasks.front() );
+        victim.tasks.pop_front();
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  bool runPendingTask( std::size_t index )
+  {
+    std::function< void() > task;
+    if ( ( workerIndex() == index && popOwn( index, task ) ) || steal( index, task ) )
+    {
+      pending_--;
+      task();
+      return true;
+    }
+
+    return false;
+  }
+
+  void workerThread( std::size_t index )
+  {
+    currentWorker().pool  = this;
+    currentWorker().index = index;
+
+    while ( true )
+    {
+      if ( runPendingTask( index ) )
+      {
+        continue;
+      }
+
+      std::unique_lock< std::mutex > lock( wake_mutex_ );
+      if ( shutdown_desired_ && pending_ == 0 )
+      {
+        break;
+      }
+
+      sleeping_++;
+      wake_.wait( lock, [&]() { return shutdown_desired_ || pending_ > 0; } );
+      sleeping_--;
+    }
+  }
+
+  std::vector< std::unique_ptr< WorkerQueue > > queues_;
+  std::vector< std::thread >                    threads_;
+  std::atomic< std::size_t >                    next_queue_{ 0 };
+
+  // tasks queued but not yet started, and idle workers waiting for one
+  std::atomic< std::size_t > pending_{ 0 };
+  std::atomic< std::size_t > sleeping_{ 0 };
+  std::mutex                 wake_mutex_;
+  std::condition_variable    wake_;
+  bool                       shutdown_desired_ = false;
+};
+
+}  // namespace fsm
@@ -0,0 +1,336 @@
+/**
+ * @file fsm_timeout_supervisor.hpp
+ * @brief Process-wide timer heap supervising runner timeouts
+ * @date 2026-10-16
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "fsm_clocks.hpp"
+
+namespace fsm
+{
+/**
+ * @brief Time between timeout handler calls repeating at frequency, see TimeoutSupervisor::Subscription
+ *
+ * @param frequency Calls per second
+ * @throw std::invalid_argument if frequency is not positive or so high that the period rounds to zero
+ */
+inline std::chrono::nanoseconds timeoutRepeatPeriod( double frequency )
+{
+  if ( !( frequency > 0 ) || toNanoseconds( 1.0 / frequency ) <= std::chrono::nanoseconds::zero() )
+  {
+    throw std::invalid_argument( "timeout repeat frequency must be positive" );
+  }
+  return toNanoseconds( 1.0 / frequency );
+}
+
+/**
+ * @class TimeoutSupervisor
+ * @brief One thread and an indexed min-heap of deadlines supervising the timeouts of any number of runners. The
+ * thread sleeps until the earliest deadline. Deadlines are integer nanoseconds since the epoch of TClock. A runner re-arms by storing a new deadline in its subscription, which
+ * costs an atomic store; the heap entry is only moved when its old deadline comes due. The work done thus scales
+ * with the number of deadlines that come due, not with the number of runners or responses. Removing a
+ * subscription takes it out of the heap right away.
+ *
+ * @tparam TClock Clock the deadlines are measured with
+ */
+template < typename TClock >
+class TimeoutSupervisor
+{
+ public:
+  /**
+   * @brief A supervised deadline
+   */
+  struct Subscription
+  {
+    std::atomic< std::chrono::nanoseconds > Deadline{ std::chrono::nanoseconds::max() };  // since the TClock epoch, max is never
+    std::chrono::nanoseconds                Repeat{ std::chrono::seconds( 1 ) };         // until the next expiry if the deadline is not re-armed, positive
+    std::function< void() >                 Expired;                                     // runs on the supervisor thread
+
+   private:
+    friend class TimeoutSupervisor;
+
+    // guarded by the supervisor mutex
+    std::chrono::nanoseconds due_{ 0 };
+    std::size_t              heap_index_ = 0;
+    bool                     active_     = false;
+    bool                     firing_     = false;
+  };
+
+  TimeoutSupervisor()
+    : thread_( &TimeoutSupervisor::supervisorThread, this )
+  {
+  }
+
+  TimeoutSupervisor( const TimeoutSupervisor& ) = delete;
+  void operator=( const TimeoutSupervisor& ) = delete;
+
+  ~TimeoutSupervisor()
+  {
+    {
+      std::unique_lock< std::mutex > lock( mutex_ );
+      shutdown_desired_ = true;
+    }
+    wakeup_.notify_all();
+    thread_.join();
+  }
+
+  /**
+   * @brief Supervisor shared by every runner on TClock. It is never destroyed, so runners with static storage
+   * duration can still remove their subscriptions during exit.
+   */
+  static TimeoutSupervisor& shared()
+  {
+    static TimeoutSupervisor* supervisor = new TimeoutSupervisor();
+    return *supervisor;
+  }
+
+  /**
+   * @brief Starts supervising a subscription at its current deadline, O(log n)
+   *
+   * @throw std::invalid_argument if the repeat of the subscription is not positive, which would fire it back to
+   * back
+   */
+  void add( const std::shared_ptr< Subscription >& subscription )
+  {
+    if ( subscription->Repeat <= std::chrono::nanoseconds::zero() )
+    {
+      throw std::invalid_argument( "timeout repeat must be positive" );
+    }
+
+    {
+      std::unique_lock< std::mutex > lock( mutex_ );
+      if ( subscription->active_ )
+      {
+        return;
+      }
+
+      subscription->active_ = true;
+      subscription->due_    = subscription->Deadline.load();
+      push( subscription );
+      if ( heap_.front() != subscription )
+      {
+        return;  // the supervisor already wakes earlier
+      }
+    }
+    wakeup_.notify_all();
+  }
+
+  /**
+   * @brief Stops supervising a subscription and drops it from the heap, O(log n). Once this returns Expired of
+   * this subscription is not running and will not run again, unless called from Expired itself. Expiries of other
+   * subscriptions are not waited for.
+   */
+  void remove( const std::shared_ptr< Subscription >& subscription )
+  {
+    std::unique_lock< std::mutex > lock( mutex_ );
+    if ( subscription->active_ )
+    {
+      subscription->active_ = false;
+      erase( subscription->heap_index_ );
+    }
+
+    // wait out an expiry of this subscription in progress
+    if ( std::this_thread::get_id() != thread_.get_id() )
+    {
+      fired_.wait( lock, [&]() { return !subscription->firing_; } );
+    }
+  }
+
+  /**
+   * @brief Number of supervised subscriptions
+   */
+  std::size_t size() const
+  {
+    std::unique_lock< std::mutex > lock( mutex_ );
+    return heap_.size();
+  }
+
+ private:
+  using Handle = std::shared_ptr< Subscription >;
+
+  void supervisorThread()
+  {
+    std::vector< Handle >          expired;
+    std::unique_lock< std::mutex > lock( mutex_ );
+    while ( !shutdown_desired_ )
+    {
+      if ( heap_.empty() )
+      {
+        wakeup_.wait( lock );
+        continue;
+      }
+
+      const std::chrono::nanoseconds now = TClock::sinceEpoch();
+      if ( heap_.front()->due_ > now )
+      {
+        wakeup_.wait_for( lock, ClockTraits< TClock >::waitFor( heap_.front()->due_ - now ) );
+        continue;
+      }
+
+      // move what came due to its current deadline, entries re-armed since they were pushed just move
+      while ( !heap_.empty() && heap_.front()->due_ <= now )
+      {
+        Handle                   subscription = heap_.front();
+        std::chrono::nanoseconds deadline     = subscription->Deadline.load();
+        if ( deadline <= now )
+        {
+          expired.push_back( subscription );
+          subscription->firing_ = true;
+          subscription->Deadline.compare_exchange_strong( deadline, now + subscription->Repeat );
+        }
+        subscription->due_ = subscription->Deadline.load();
+        siftDown( 0 );
+      }
+
+      if ( expired.empty() )
+      {
+        continue;
+      }
+
+      // fire unlocked so handlers may add or remove subscriptions, they read now from FSMCycleBaseClock
+      lock.unlock();
+      {
+        typename FSMCycleBaseClock< TClock >::Scope snapshot( now );
+        for ( const auto& subscription : expired )
+        {
+          {
+            std::unique_lock< std::mutex > check( mutex_ );
+            if ( !subscription->active_ )
+            {
+              subscription->firing_ = false;
+              fired_.notify_all();
+              continue;
+            }
+          }
+
+          subscription->Expired();
+
+          std::unique_lock< std::mutex > done( mutex_ );
+          subscription->firing_ = false;
+          fired_.notify_all();
+        }
+      }
+      expired.clear();
+      lock.lock();
+    }
+  }
+
+  // the heap keeps the earliest due_ at the front, each subscription knows its index for erase
+  void place( std::size_t index, Handle subscription )
+  {
+    subscription->heap_index_ = index;
+    heap_[index]              = std::move( subscription );
+  }
+
+  void push( const Handle& subscription )
+  {
+    heap_.push_back( subscription );
+    subscription->heap_index_ = heap_.size() - 1;
+    siftUp( heap_.size() - 1 );
+  }
+
+  void erase( std::size_t index )
+  {
+    Handle last = std::move( heap_.back() );
+    heap_.pop_back();
+    if ( index == heap_.size() )
+    {
+      return;
+    }
+
+    place( index, std::move( last ) );
+    siftUp( index );
+    siftDown( index );
+  }
+
+  void siftUp( std::size_t index )
+  {
+    while ( index > 0 )
+    {
+      const std::size_t parent = ( index - 1 ) / 2;
+      if ( !( heap_[index]->due_ < heap_[parent]->due_ ) )
+      {
+        break;
+      }
+      Handle moved = std::move( heap_[index] );
+      place( index, std::move( heap_[parent] ) );
+      place( parent, std::move( moved ) );
+      index = parent;
+    }
+  }
+
+  void siftDown( std::size_t index )
+  {
+    while ( index < heap_.size() )
+    {
+      const std::size_t left     = 2 * index + 1;
+      const std::size_t right    = left + 1;
+      std::size_t       earliest = index;
+      if ( left < heap_.size() && heap_[left]->due_ < heap_[earliest]->due_ )
+      {
+        earliest = left;
+      }
+      if ( right < heap_.size() && heap_[right]->due_ < heap_[earliest]->due_ )
+      {
+        earliest = right;
+      }
+      if ( earliest == index )
+      {
+        break;
+      }
+      Handle moved = std::move( heap_[index] );
+      place( index, std::move( heap_[earliest] ) );
+      place( earliest, std::move( moved ) );
+      index = earliest;
+    }
+  }
+
+  std::vector< Handle > heap_;
+
+  mutable std::mutex      mutex_;
+  std::condition_variable wakeup_;
+  std::condition_variable fired_;
+  bool                    shutdown_desired_ = false;
+  std::thread             thread_;
+};
+
+}  // namespace fsm
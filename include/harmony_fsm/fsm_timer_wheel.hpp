@@ -0,0 +1,380 @@
+/**
+ * @file fsm_timer_wheel.hpp
+ * @brief Harmony FSM hierarchical timer wheel
+ * @date 2026-10-16
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "fsm_clocks.hpp"
+
+namespace fsm
+{
+/**
+ * @class TimerWheel
+ * @brief Timer service for many timers on TClock: a hierarchical timing wheel of four levels of 256 slots, each
+ * slot an intrusive list. Arming, re-arming and cancelling a timer is O(1). tick reads the clock once and expires
+ * every timer that came due since the last tick as one batch; timers are rounded up to the resolution. Levels
+ * above the first are cascaded down as time reaches them, and stretches without timers are skipped. Not thread
+ * safe, arm, cancel and tick from one thread. Must outlive its timers.
+ *
+ * @tparam TClock Clock the wheel reads on tick, e.g. FSMSteadyClock or FSMVirtualClock
+ */
+template < typename TClock >
+class TimerWheel
+{
+ public:
+  static constexpr std::size_t LevelBits  = 8;
+  static constexpr std::size_t SlotCount  = std::size_t( 1 ) << LevelBits;
+  static constexpr std::size_t LevelCount = 4;
+
+  /**
+   * @class Timer
+   * @brief Timer armed on a TimerWheel. isElapsed reads a flag set by the wheel's tick instead of the clock.
+   */
+  class Timer
+  {
+   public:
+    /**
+     * @brief Construct a new Timer object
+     *
+     * @param callback Runs on the thread calling tick when the timer expires
+     */
+    explicit Timer( std::function< void() > callback = nullptr )
+      : callback_( std::move( callback ) )
+    {
+    }
+
+    Timer( const Timer& ) = delete;
+    void operator=( const Timer& ) = delete;
+
+    ~Timer()
+    {
+      cancel();
+    }
+
+    void setCallback( std::function< void() > callback )
+    {
+      callback_ = std::move( callback );
+    }
+
+    bool armed() const
+    {
+      return slot_ != nullptr;
+    }
+
+    /**
+     * @brief Whether the timer expired since it was last armed
+     */
+    bool isElapsed() const
+    {
+      return elapsed_;
+    }
+
+    /**
+     * @brief Disarms the timer and clears isElapsed
+     */
+    void cancel()
+    {
+      elapsed_ = false;
+      if ( wheel_ != nullptr )
+      {
+        wheel_->unlink( *this );
+      }
+    }
+
+   private:
+    friend class TimerWheel;
+
+    std::function< void() > callback_;
+    TimerWheel*             wheel_   = nullptr;
+    Timer**                 slot_    = nullptr;
+    Timer*                  prev_    = nullptr;
+    Timer*                  next_    = nullptr;
+    std::uint64_t           expires_ = 0;
+    std::size_t             level_   = 0;
+    bool                    elapsed_ = false;
+  };
+
+  /**
+   * @brief Construct a new Timer Wheel object starting at the current time of TClock
+   *
+   * @param resolution Seconds per tick of the wheel
+   */
+  explicit TimerWheel( double resolution = 0.001 )
+    : resolution_( resolution )
+    , origin_( TClock::toSec() )
+    , now_( origin_ )
+  {
+    std::fill( &slots_[0][0], &slots_[0][0] + LevelCount * SlotCount, nullptr );
+  }
+
+  TimerWheel( const TimerWheel& ) = delete;
+  void operator=( const TimerWheel& ) = delete;
+
+  ~TimerWheel()
+  {
+    for ( auto& level : slots_ )
+    {
+      for ( auto& slot : level )
+      {
+        while ( slot != nullptr )
+        {
+          unlink( *slot );
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Arms or re-arms a timer to expire seconds after the last tick, O(1)
+   */
+  void arm( Timer& timer, double seconds )
+  {
+    unlink( timer );
+    const double ticks = std::ceil( seconds / resolution_ );
+    timer.wheel_       = this;
+    timer.elapsed_     = false;
+    timer.expires_     = next_tick_ - 1 + static_cast< std::uint64_t >( std::max( 1.0, ticks ) );
+    insert( timer );
+  }
+
+  /**
+   * @brief Cancels a timer, O(1)
+   */
+  void cancel( Timer& timer )
+  {
+    timer.cancel();
+  }
+
+  /**
+   * @brief Reads TClock once and expires the timers that came due
+   *
+   * @return Number of timers expired
+   */
+  std::size_t tick()
+  {
+    return tick( TClock::toSec() );
+  }
+
+  /**
+   * @brief Advances the wheel to now and expires the timers that came due, as a batch after the wheel has
+   * advanced. Callbacks may arm and cancel timers, but not destroy another timer of the same batch.
+   *
+   * @param now Current time of TClock
+   * @return Number of timers expired
+   */
+  std::size_t tick( double now )
+  {
+    now_ = std::max( now_, now );
+    const std::uint64_t target = static_cast< std::uint64_t >( std::max( 0.0, std::floor( ( now_ - origin_ ) / resolution_ ) ) );
+
+    while ( next_tick_ <= target )
+    {
+      if ( armed_ == 0 )
+      {
+        next_tick_ = target + 1;
+        break;
+      }
+
+      // nothing expires or cascades before the next multiple of the first busy level's span
+      std::size_t empty_levels = 0;
+      while ( empty_levels < LevelCount - 1 && level_armed_[empty_levels] == 0 )
+      {
+        empty_levels++;
+      }
+      const std::uint64_t span = std::uint64_t( 1 ) << ( LevelBits * empty_levels );
+      if ( next_tick_ % span != 0 )
+      {
+        next_tick_ = std::min( ( next_tick_ / span + 1 ) * span, target + 1 );
+        continue;
+      }
+
+      advance();
+    }
+
+    // callbacks run once the wheel is consistent, a timer re-armed or cancelled meanwhile is skipped
+    std::size_t fired = 0;
+    for ( std::size_t i = 0; i < expired_.size(); i++ )
+    {
+      Timer* timer = expired_[i];
+      if ( timer->elapsed_ && !timer->armed() )
+      {
+        fired++;
+        if ( timer->callback_ )
+        {
+          timer->callback_();
+        }
+      }
+    }
+    expired_.clear();
+    return fired;
+  }
+
+  /**
+   * @brief Time of TClock read by the last tick, shared by all timers of the wheel
+   */
+  double now() const
+  {
+    return now_;
+  }
+
+  double resolution() const
+  {
+    return resolution_;
+  }
+
+  /**
+   * @brief Number of armed timers
+   */
+  std::size_t size() const
+  {
+    return armed_;
+  }
+
+ private:
+  static std::size_t slotIndex( std::uint64_t ticks, std::size_t level )
+  {
+    return static_cast< std::size_t >( ( ticks >> ( LevelBits * level ) ) & ( SlotCount - 1 ) );
+  }
+
+  void insert( Timer& timer )
+  {
+    // timers too far out wait in the last level and cascade down when it comes around
+    const std::uint64_t delta = timer.expires_ > next_tick_ ? timer.expires_ - next_tick_ : 0;
+    const std::uint64_t max   = ( std::uint64_t( 1 ) << ( LevelBits * LevelCount ) ) - 1;
+    const std::uint64_t at    = delta == 0 ? next_tick_ : next_tick_ + std::min( delta, max );
+
+    std::size_t level = 0;
+    while ( level < LevelCount - 1 && delta >= ( std::uint64_t( 1 ) << ( LevelBits * ( level + 1 ) ) ) )
+    {
+      level++;
+    }
+
+    Timer** slot = &slots_[level][slotIndex( at, level )];
+    timer.level_ = level;
+    timer.slot_  = slot;
+    timer.prev_  = nullptr;
+    timer.next_  = *slot;
+    if ( *slot != nullptr )
+    {
+      ( *slot )->prev_ = &timer;
+    }
+    *slot = &timer;
+    armed_++;
+    level_armed_[level]++;
+  }
+
+  void unlink( Timer& timer )
+  {
+    if ( timer.slot_ == nullptr )
+    {
+      return;
+    }
+
+    if ( timer.prev_ != nullptr )
+    {
+      timer.prev_->next_ = timer.next_;
+    }
+    else
+    {
+      *timer.slot_ = timer.next_;
+    }
+    if ( timer.next_ != nullptr )
+    {
+      timer.next_->prev_ = timer.prev_;
+    }
+
+    timer.slot_ = nullptr;
+    timer.prev_ = nullptr;
+    timer.next_ = nullptr;
+    armed_--;
+    level_armed_[timer.level_]--;
+  }
+
+  // re-inserts the timers of a slot relative to the current tick, returns the slot index
+  std::size_t cascade( std::size_t level )
+  {
+    const std::size_t index = slotIndex( next_tick_, level );
+    Timer*            timer = slots_[level][index];
+    while ( timer != nullptr )
+    {
+      Timer* next = timer->next_;
+      unlink( *timer );
+      insert( *timer );
+      timer = next;
+    }
+    return index;
+  }
+
+  // processes tick next_tick_: cascades on level boundaries, then expires the first level's slot
+  void advance()
+  {
+    const std::size_t index = slotIndex( next_tick_, 0 );
+    for ( std::size_t level = 1; index == 0 && level < LevelCount; level++ )
+    {
+      if ( cascade( level ) != 0 )
+      {
+        break;
+      }
+    }
+    next_tick_++;
+
+    Timer** slot = &slots_[0][index];
+    while ( *slot != nullptr )
+    {
+      Timer* timer = *slot;
+      unlink( *timer );
+      timer->elapsed_ = true;
+      expired_.push_back( timer );
+    }
+  }
+
+  double resolution_;
+  double origin_;
+  double now_;
+
+  // next_tick_ is the first tick not yet processed, ticks count resolution steps from origin_
+  std::uint64_t next_tick_ = 1;
+  Timer*        slots_[LevelCount][SlotCount];
+  std::size_t   armed_                    = 0;
+  std::size_t   level_armed_[LevelCount] = {};
+
+  std::vector< Timer* > expired_;
+};
+
+}  // namespace fsm
@@ -0,0 +1,337 @@
+/**
+ * @file static_finite_state_machine.hpp
+ * @brief Harmony Finite State Machine with a transition table built at compile time
+ * @date 2026-10-16
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+
+#include "event_table_entry.hpp"
+#include "fsm_batch.hpp"
+#include "fsm_enum_set.hpp"
+#include "fsm_enum_traits.hpp"
+
+namespace fsm
+{
+namespace detail
+{
+/**
+ * @brief Fixed size code storage that can be filled in a constant expression
+ */
+template < typename TCode, std::size_t Size >
+struct StaticCodeArray
+{
+  TCode codes[Size];
+};
+
+/**
+ * @brief Whether two rows share the same current state and trigger
+ */
+template < typename TEvent, typename TState, std::size_t N >
+constexpr bool hasDuplicateTransitions( const std::array< EventTableEntry< TEvent, TState >, N >& fsm_table )
+{
+  for ( std::size_t i = 0; i < N; i++ )
+  {
+    for ( std::size_t j = i + 1; j < N; j++ )
+    {
+      if ( fsm_table[i].Current == fsm_table[j].Current && fsm_table[i].Trigger == fsm_table[j].Trigger )
+      {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+/**
+ * @brief Whether every row lies inside the TState/TEvent enum ranges
+ */
+template < typename TEvent, typename TState, std::size_t N >
+constexpr bool isTableInRange( const std::array< EventTableEntry< TEvent, TState >, N >& fsm_table )
+{
+  for ( std::size_t i = 0; i < N; i++ )
+  {
+    if ( enumIndex( fsm_table[i].Current ) >= EnumTraits< TState >::count || enumIndex( fsm_table[i].Result ) >= EnumTraits< TState >::count ||
+         enumIndex( fsm_table[i].Trigger ) >= EnumTraits< TEvent >::count )
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * @brief Flattens table rows into a states x events array of result codes, invalid_code marks undefined transitions
+ */
+template < typename TCode, std::size_t StateCount, std::size_t EventCount, typename TEvent, typename TState, std::size_t N >
+constexpr StaticCodeArray< TCode, StateCount * EventCount > buildTransitionCodes( const std::array< EventTableEntry< TEvent, TState >, N >& fsm_table,
+                                                                                 TCode invalid_code )
+{
+  StaticCodeArray< TCode, StateCount * EventCount > res{};
+  for ( std::size_t i = 0; i < StateCount * EventCount; i++ )
+  {
+    res.codes[i] = invalid_code;
+  }
+
+  for ( std::size_t i = 0; i < N; i++ )
+  {
+    res.codes[enumIndex( fsm_table[i].Current ) * EventCount + enumIndex( fsm_table[i].Trigger )] =
+        static_cast< TCode >( enumIndex( fsm_table[i].Result ) );
+  }
+
+  return res;
+}
+}  // namespace detail
+
+/**
+ * @class StaticFiniteStateMachine
+ * @brief Finite state machine whose transition table is a constexpr std::array known at build time.
+ * The lookup is flattened at compile time into a static states x events array, so the machine itself is
+ * only its current state, needs no heap, and doEvent is a single indexed load. Duplicate
+ * (Current, Trigger) rows and rows outside the enum ranges fail to compile.
+ *
+ * static constexpr std::array< fsm::EventTableEntry< EVENT, RUNSTATE >, 7 > TABLE = { { ... } };
+ * fsm::StaticFiniteStateMachine< EVENT, RUNSTATE, TABLE.size(), TABLE > machine( RUNSTATE::RED );
+ *
+ * @tparam TEvent Event type, needs a COUNT sentinel or an EnumTraits specialization
+ * @tparam TState State type, needs a COUNT sentinel or an EnumTraits specialization
+ * @tparam N Number of table rows
+ * @tparam Table Transition table with static storage duration
+ */
+template < typename TEvent, typename TState, std::size_t N, const std::array< EventTableEntry< TEvent, TState >, N >& Table >
+class StaticFiniteStateMachine
+{
+  static_assert( HasEnumTraits< TState >::value, "TState needs a COUNT sentinel or an fsm::EnumTraits specialization" );
+  static_assert( HasEnumTraits< TEvent >::value, "TEvent needs a COUNT sentinel or an fsm::EnumTraits specialization" );
+  static_assert( detail::isTableInRange( Table ), "transition table entry outside of the TState/TEvent enum range" );
+  static_assert( !detail::hasDuplicateTransitions( Table ), "transition table has duplicate (Current, Trigger) rows" );
+
+ public:
+  static constexpr std::size_t StateCount = EnumTraits< TState >::count;
+  static constexpr std::size_t EventCount = EnumTraits< TEvent >::count;
+
+  // result code of a transition, the index of the resultant state or InvalidCode
+  using code_type = typename SmallestUnsigned< StateCount >::type;
+
+  static constexpr code_type InvalidCode = static_cast< code_type >( StateCount );
+
+  /**
+   * @brief Construct a new Static Finite State Machine object.
+   *
+   * @param init_state Initial state
+   * @throw std::out_of_range if init_state lies outside the TState enum range
+   */
+  constexpr explicit StaticFiniteStateMachine( TState init_state )
+    : current_state_( enumIndex( init_state ) < StateCount ? init_state : throw std::out_of_range( "initial state outside of the TState enum range" ) )
+  {
+  }
+
+  /**
+   * @brief Execute a state machine transition
+   * @param trigger
+   * @return true if the state change was executed successfully
+   */
+  bool doEvent( const TEvent& trigger )
+  {
+    TState res = current_state_;
+    if ( lookup( current_state_, trigger, res ) )
+    {
+      current_state_ = res;
+      return true;
+    }
+
+    return false;
+  }
+
+  /**
+   * @brief Checks whether the current transition event could yield a new state
+   *
+   * @param trigger
+   * @param next_state The next state given this transition
+   * @return true
+   * @return false
+   */
+  constexpr bool isValid( const TEvent& trigger, TState& next_state ) const
+  {
+    return lookup( current_state_, trigger, next_state );
+  }
+
+  constexpr TState getCurrentState() const
+  {
+    return current_state_;
+  }
+
+  /**
+   * @brief Events with a transition defined from the current state
+   */
+  const EnumSet< TEvent >& validEvents() const
+  {
+    return validEventsFrom( current_state_ );
+  }
+
+  /**
+   * @brief Events with a transition defined from a state, empty for states outside of the enum range
+   */
+  const EnumSet< TEvent >& validEventsFrom( const TState& state ) const
+  {
+    return setTables().Events[rowIndex( state )];
+  }
+
+  /**
+   * @brief States reachable in a single transition from the current state
+   */
+  const EnumSet< TState >& nextStates() const
+  {
+    return nextStatesFrom( current_state_ );
+  }
+
+  /**
+   * @brief States reachable in a single transition from a state, empty for states outside of the enum range
+   */
+  const EnumSet< TState >& nextStatesFrom( const TState& state ) const
+  {
+    return setTables().States[rowIndex( state )];
+  }
+
+  /**
+   * @brief Applies a span of events in one call
+   *
+   * @param first First event
+   * @param last One past the last event
+   * @param policy How invalid events are handled, see BatchPolicy
+   * @param states_out Optional, last - first states, the state after each applied event
+   * @return BatchResult< TState > events applied or index of the offending event, and the final state
+   */
+  BatchResult< TState > doEvents( const TEvent* first,
+                                  const TEvent* last,
+                                  BatchPolicy   policy     = BatchPolicy::STOP_AT_INVALID,
+                                  TState*       states_out = nullptr )
+  {
+    auto static_lookup = []( const TState& current, const TEvent& trigger, TState& next_state ) {
+      return lookup( current, trigger, next_state );
+    };
+
+    const auto res = applyBatch( current_state_, first, last, policy, states_out, static_lookup );
+    current_state_ = res.State;
+    return res;
+  }
+
+  /**
+   * @brief Looks up a transition in the compile time table
+   *
+   * @param current Current state
+   * @param trigger Event trigger
+   * @param next_state The next state given this transition
+   * @return true if the transition is defined
+   */
+  static constexpr bool lookup( const TState& current, const TEvent& trigger, TState& next_state )
+  {
+    const std::size_t state_idx = enumIndex( current );
+    const std::size_t event_idx = enumIndex( trigger );
+    if ( state_idx >= StateCount || event_idx >= EventCount )
+    {
+      return false;
+    }
+
+    const code_type res = codes_.codes[state_idx * EventCount + event_idx];
+    if ( res == InvalidCode )
+    {
+      return false;
+    }
+
+    next_state = static_cast< TState >( res );
+    return true;
+  }
+
+ private:
+  // per state sets, the extra last row stays empty for states outside of the range
+  struct SetTables
+  {
+    std::array< EnumSet< TEvent >, StateCount + 1 > Events;
+    std::array< EnumSet< TState >, StateCount + 1 > States;
+  };
+
+  static std::size_t rowIndex( const TState& state )
+  {
+    return enumIndex( state ) < StateCount ? enumIndex( state ) : StateCount;
+  }
+
+  // bitsets are not constexpr in C++14, so the sets are built once on the first query
+  static const SetTables& setTables()
+  {
+    static const SetTables tables = []() {
+      SetTables res;
+      for ( std::size_t state_idx = 0; state_idx < StateCount; state_idx++ )
+      {
+        for ( std::size_t event_idx = 0; event_idx < EventCount; event_idx++ )
+        {
+          const code_type code = codes_.codes[state_idx * EventCount + event_idx];
+          if ( code != InvalidCode )
+          {
+            res.Events[state_idx].set( static_cast< TEvent >( event_idx ) );
+            res.States[state_idx].set( static_cast< TState >( code ) );
+          }
+        }
+      }
+
+      return res;
+    }();
+
+    return tables;
+  }
+
+  static constexpr detail::StaticCodeArray< code_type, StateCount * EventCount > codes_ =
+      detail::buildTransitionCodes< code_type, StateCount, EventCount >( Table, InvalidCode );
+
+  TState current_state_;
+};
+
+template < typename TEvent, typename TState, std::size_t N, const std::array< EventTableEntry< TEvent, TState >, N >& Table >
+constexpr std::size_t StaticFiniteStateMachine< TEvent, TState, N, Table >::StateCount;
+
+template < typename TEvent, typename TState, std::size_t N, const std::array< EventTableEntry< TEvent, TState >, N >& Table >
+constexpr std::size_t StaticFiniteStateMachine< TEvent, TState, N, Table >::EventCount;
+
+template < typename TEvent, typename TState, std::size_t N, const std::array< EventTableEntry< TEvent, TState >, N >& Table >
+constexpr typename StaticFiniteStateMachine< TEvent, TState, N, Table >::code_type StaticFiniteStateMachine< TEvent, TState, N, Table >::InvalidCode;
+
+template < typename TEvent, typename TState, std::size_t N, const std::array< EventTableEntry< TEvent, TState >, N >& Table >
+constexpr detail::StaticCodeArray< typename StaticFiniteStateMachine< TEvent, TState, N, Table >::code_type,
+                                   StaticFiniteStateMachine< TEvent, TState, N, Table >::StateCount *
+                                       StaticFiniteStateMachine< TEvent, TState, N, Table >::EventCount >
+    StaticFiniteStateMachine< TEvent, TState, N, Table >::codes_;
+
+}  // namespace fsm
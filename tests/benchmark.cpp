@@ -0,0 +1,435 @@
+#define CATCH_CONFIG_MAIN
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <harmony_fsm/concurrent_finite_state_machine.hpp>
+#include <harmony_fsm/dense_finite_state_machine.hpp>
+#include <harmony_fsm/fsm_inline_runner.hpp>
+#include <harmony_fsm/fsm_rate.hpp>
+#include <harmony_fsm/fsm_runner.hpp>
+#include <harmony_fsm/fsm_timer_wheel.hpp>
+
+#include "catch.hpp"
+
+using namespace std;
+using dseconds = std::chrono::duration< double >;
+
+// a table large enough to leave the L1 cache, with every transition defined
+enum class BENCHEVENT : uint16_t
+{
+  COUNT = 256
+};
+
+enum class BENCHSTATE : uint16_t
+{
+  COUNT = 1024
+};
+
+using BenchMachine           = fsm::DenseFiniteStateMachine< BENCHEVENT, BENCHSTATE >;
+using BenchConcurrentMachine = fsm::ConcurrentFiniteStateMachine< BENCHEVENT, BENCHSTATE >;
+
+static shared_ptr< const BenchMachine::TransitionTable > benchTable()
+{
+  mt19937                                                  gen( 1 );
+  uniform_int_distribution< unsigned >                     dist( 0, fsm::EnumTraits< BENCHSTATE >::count - 1 );
+  vector< fsm::EventTableEntry< BENCHEVENT, BENCHSTATE > > rows;
+  for ( unsigned s = 0; s < fsm::EnumTraits< BENCHSTATE >::count; s++ )
+  {
+    for ( unsigned e = 0; e < fsm::EnumTraits< BENCHEVENT >::count; e++ )
+    {
+      rows.push_back( { static_cast< BENCHEVENT >( e ), static_cast< BENCHSTATE >( s ), static_cast< BENCHSTATE >( dist( gen ) ) } );
+    }
+  }
+
+  return fsm::makeSharedTable< BenchMachine::TransitionTable >( rows );
+}
+
+static vector< vector< BENCHEVENT > > benchStreams( size_t streams, size_t length )
+{
+  mt19937                              gen( 2 );
+  uniform_int_distribution< unsigned > dist( 0, fsm::EnumTraits< BENCHEVENT >::count - 1 );
+  vector< vector< BENCHEVENT > >       res( streams, vector< BENCHEVENT >( length ) );
+  for ( auto& stream : res )
+  {
+    for ( auto& evt : stream )
+    {
+      evt = static_cast< BENCHEVENT >( dist( gen ) );
+    }
+  }
+
+  return res;
+}
+
+template < typename TFun >
+static double eventsPerSecond( size_t events, TFun fun )
+{
+  const auto start = chrono::steady_clock::now();
+  fun();
+  return events / chrono::duration_cast< dseconds >( chrono::steady_clock::now() - start ).count();
+}
+
+template < size_t Lanes >
+static void benchInterleaved( const shared_ptr< const BenchMachine::TransitionTable >& table,
+                              const vector< vector< BENCHEVENT > >&                    streams,
+                              const vector< BenchMachine >&                            expected,
+                              double                                                   baseline )
+{
+  vector< BenchMachine >              machines( streams.size(), BenchMachine( table, BENCHSTATE( 0 ) ) );
+  vector< BenchMachine::EventStream > ranges;
+  for ( const auto& stream : streams )
+  {
+    ranges.push_back( { stream.data(), stream.data() + stream.size() } );
+  }
+
+  const double rate = eventsPerSecond( streams.size() * streams[0].size(),
+                                       [&]() { BenchMachine::stepInterleaved< Lanes >( machines.data(), ranges.data(), ranges.size() ); } );
+
+  cout << "stepInterleaved< " << Lanes << " >: " << rate << " events/s, " << rate / baseline << "x" << endl;
+  for ( size_t i = 0; i < machines.size(); i++ )
+  {
+    REQUIRE( machines[i].getCurrentState() == expected[i].getCurrentState() );
+  }
+}
+
+TEST_CASE( "Interleaved stepping benchmark" )
+{
+  const auto table   = benchTable();
+  const auto streams = benchStreams( 16, 1 << 20 );
+
+  vector< BenchMachine > sequential( streams.size(), BenchMachine( table, BENCHSTATE( 0 ) ) );
+  const double           baseline = eventsPerSecond( streams.size() * streams[0].size(), [&]() {
+    for ( size_t i = 0; i < streams.size(); i++ )
+    {
+      for ( const auto evt : streams[i] )
+      {
+        sequential[i].doEvent( evt );
+      }
+    }
+  } );
+
+  cout << "doEvent per stream: " << baseline << " events/s" << endl;
+  benchInterleaved< 1 >( table, streams, sequential, baseline );
+  benchInterleaved< 4 >( table, streams, sequential, baseline );
+  benchInterleaved< 8 >( table, streams, sequential, baseline );
+  benchInterleaved< 16 >( table, streams, sequential, baseline );
+}
+
+// every producer thread fires its own stream at one shared machine
+template < typename TFun >
+static double contendedEventsPerSecond( const vector< vector< BENCHEVENT > >& streams, TFun fun )
+{
+  return eventsPerSecond( streams.size() * streams[0].size(), [&]() {
+    vector< thread > producers;
+    for ( const auto& stream : streams )
+    {
+      producers.emplace_back( [&]() {
+        for ( const auto evt : stream )
+        {
+          fun( evt );
+        }
+      } );
+    }
+    for ( auto& producer : producers )
+    {
+      producer.join();
+    }
+  } );
+}
+
+TEST_CASE( "Contended machine benchmark" )
+{
+  const auto table    = benchTable();
+  const auto hardware = max( 4u, thread::hardware_concurrency() );
+
+  for ( const unsigned threads : { 1u, 2u, hardware } )
+  {
+    const auto streams = benchStreams( threads, ( 1 << 22 ) / threads );
+
+    BenchMachine locked( table, BENCHSTATE( 0 ) );
+    mutex        locked_mutex;
+    const double mutex_rate = contendedEventsPerSecond( streams, [&]( BENCHEVENT evt ) {
+      lock_guard< mutex > lock( locked_mutex );
+      locked.doEvent( evt );
+    } );
+
+    BenchConcurrentMachine concurrent( table, BENCHSTATE( 0 ) );
+    const double           cas_rate = contendedEventsPerSecond( streams, [&]( BENCHEVENT evt ) { concurrent.doEvent( evt ); } );
+
+    cout << threads << " producers: mutex " << mutex_rate << " events/s, compare-and-swap " << cas_rate << " events/s, "
+         << cas_rate / mutex_rate << "x" << endl;
+    REQUIRE( cas_rate > 0 );
+  }
+}
+
+TEST_CASE( "Runner completion latency benchmark" )
+{
+  using Runner = fsm::FiniteStateMachineRunner< BENCHEVENT, BENCHSTATE, fsm::UnusedCommandParameter, int, fsm::FSMSteadyClock >;
+
+  const size_t samples = 20;
+
+  // paced is the baseline, results wait for the next period of the 10 Hz runner
+  for ( const bool paced : { true, false } )
+  {
+    mutex                            completion_mutex;
+    condition_variable               completion_cond;
+    size_t                           completions = 0;
+    chrono::steady_clock::time_point completed_at;
+
+    // two states toggled by one event, the state functions return immediately
+    Runner runner( { { BENCHEVENT( 0 ), BENCHSTATE( 0 ), BENCHSTATE( 1 ) }, { BENCHEVENT( 0 ), BENCHSTATE( 1 ), BENCHSTATE( 0 ) } },
+                   BENCHSTATE( 0 ),
+                   0,
+                   10,
+                   []( const fsm::UnusedCommandParameter* ) { return 0; },
+                   [&]( const int& ) {
+                     lock_guard< mutex > lock( completion_mutex );
+                     completed_at = chrono::steady_clock::now();
+                     completions++;
+                     completion_cond.notify_all();
+                   } );
+    runner.setPacedCompletion( paced );
+    runner.start();
+
+    // the initial result is delivered first
+    unique_lock< mutex > lock( completion_mutex );
+    completion_cond.wait( lock, [&]() { return completions == 1; } );
+
+    vector< double > latencies;
+    for ( size_t i = 0; i < samples; i++ )
+    {
+      lock.unlock();
+      const auto sent = chrono::steady_clock::now();
+      REQUIRE( runner.doEventAndExecute( BENCHEVENT( 0 ) ) );
+      lock.lock();
+      completion_cond.wait( lock, [&]() { return completions == i + 2; } );
+      latencies.push_back( chrono::duration_cast< dseconds >( completed_at - sent ).count() );
+    }
+    lock.unlock();
+    runner.stop();
+
+    sort( latencies.begin(), latencies.end() );
+    double total = 0;
+    for ( const auto latency : latencies )
+    {
+      total += latency;
+    }
+
+    cout << "event to completion at 10 Hz, " << ( paced ? "paced" : "unpaced" ) << ": mean " << total / samples * 1e6 << " us, median "
+         << latencies[samples / 2] * 1e6 << " us, max " << latencies.back() * 1e6 << " us" << endl;
+  }
+}
+
+TEST_CASE( "Inline runner step benchmark" )
+{
+  using Runner       = fsm::FiniteStateMachineRunner< BENCHEVENT, BENCHSTATE, fsm::UnusedCommandParameter, int, fsm::FSMSteadyClock >;
+  using InlineRunner = fsm::InlineFiniteStateMachineRunner< BENCHEVENT, BENCHSTATE, fsm::UnusedCommandParameter, int, fsm::FSMSteadyClock >;
+
+  const vector< fsm::EventTableEntry< BENCHEVENT, BENCHSTATE > > toggle = { { BENCHEVENT( 0 ), BENCHSTATE( 0 ), BENCHSTATE( 1 ) },
+                                                                           { BENCHEVENT( 0 ), BENCHSTATE( 1 ), BENCHSTATE( 0 ) } };
+  const size_t                                                   steps  = 20000;
+
+  // each step is one event, one state function and one completion, the next step starts once it completed
+  mutex              completion_mutex;
+  condition_variable completion_cond;
+  size_t             completions = 0;
+  Runner             threaded( toggle, BENCHSTATE( 0 ), 0, 10, []( const fsm::UnusedCommandParameter* ) { return 0; }, [&]( const int& ) {
+    lock_guard< mutex > lock( completion_mutex );
+    completions++;
+    completion_cond.notify_all();
+  } );
+  threaded.start();
+  {
+    unique_lock< mutex > lock( completion_mutex );
+    completion_cond.wait( lock, [&]() { return completions == 1; } );
+  }
+
+  auto start = chrono::steady_clock::now();
+  for ( size_t i = 0; i < steps; i++ )
+  {
+    REQUIRE( threaded.doEventAndExecute( BENCHEVENT( 0 ) ) );
+    unique_lock< mutex > lock( completion_mutex );
+    completion_cond.wait( lock, [&]() { return completions == i + 2; } );
+  }
+  const double threaded_step = chrono::duration_cast< dseconds >( chrono::steady_clock::now() - start ).count() / steps;
+  threaded.stop();
+
+  size_t       inline_completions = 0;
+  InlineRunner inline_runner( toggle, BENCHSTATE( 0 ), 0, []( const fsm::UnusedCommandParameter* ) { return 0; }, [&]( const int& ) {
+    inline_completions++;
+  } );
+  inline_runner.setTimeout( 1 );
+  inline_runner.setTimeoutHandler( []( double ) {} );
+  inline_runner.start();
+
+  start = chrono::steady_clock::now();
+  for ( size_t i = 0; i < steps; i++ )
+  {
+    inline_runner.doEventAndExecute( BENCHEVENT( 0 ) );
+  }
+  const double inline_step = chrono::duration_cast< dseconds >( chrono::steady_clock::now() - start ).count() / steps;
+  REQUIRE( inline_completions == steps + 1 );
+
+  cout << "event to completion per step: threaded " << threaded_step * 1e6 << " us, inline " << inline_step * 1e6 << " us ("
+       << threaded_step / inline_step << "x)" << endl;
+}
+
+// sorts the wakeup errors in seconds and prints their percentiles
+static void printWakeupErrors( const string& name, double frequency, vector< double >& errors )
+{
+  sort( errors.begin(), errors.end() );
+  cout << name << " at " << frequency << " Hz: p50 " << errors[errors.size() / 2] * 1e6 << " us, p99 " << errors[errors.size() * 99 / 100] * 1e6
+       << " us, max " << errors.back() * 1e6 << " us" << endl;
+}
+
+// runs cycles of a rate, sleep returns how long after its deadline it woke up
+template < typename TSleep >
+static vector< double > wakeupErrors( size_t cycles, TSleep sleep )
+{
+  vector< double > errors;
+  errors.reserve( cycles );
+  for ( size_t i = 0; i < cycles; i++ )
+  {
+    errors.push_back( sleep() );
+  }
+  return errors;
+}
+
+TEST_CASE( "Rate jitter benchmark" )
+{
+  for ( const double frequency : { 1000.0, 10000.0, 20000.0 } )
+  {
+    const size_t cycles = static_cast< size_t >( frequency / 2 );
+
+    // relative sleep, the deadline is only known as the time remaining
+    fsm::SteadyRate  relative( frequency );
+    vector< double > errors = wakeupErrors( cycles, [&]() {
+      const double deadline = fsm::FSMSteadyClock::toSec() + relative.remaining();
+      relative.sleep();
+      return fsm::FSMSteadyClock::toSec() - deadline;
+    } );
+    printWakeupErrors( "relative sleep_for", frequency, errors );
+
+    fsm::SteadyChronoRate chrono_rate( frequency );
+    errors = wakeupErrors( cycles, [&]() {
+      const auto deadline = chrono_rate.deadline();
+      chrono_rate.sleep();
+      return chrono::duration_cast< dseconds >( chrono::steady_clock::now() - deadline ).count();
+    } );
+    printWakeupErrors( "absolute sleep_until", frequency, errors );
+
+#ifdef __linux__
+    fsm::MonotonicRate monotonic( frequency );
+    errors = wakeupErrors( cycles, [&]() {
+      const auto deadline = monotonic.deadline();
+      monotonic.sleep();
+      return chrono::duration_cast< dseconds >( chrono::steady_clock::now() - deadline ).count();
+    } );
+    printWakeupErrors( "absolute clock_nanosleep", frequency, errors );
+#endif
+
+    fsm::HybridRate hybrid( frequency );
+    errors = wakeupErrors( cycles, [&]() {
+      const auto deadline = hybrid.deadline();
+      hybrid.sleep();
+      return chrono::duration_cast< dseconds >( chrono::steady_clock::now() - deadline ).count();
+    } );
+    printWakeupErrors( "hybrid sleep then spin", frequency, errors );
+    const auto stats = hybrid.sleeper().stats();
+    cout << "  learned margin " << stats.Margin.count() / 1e3 << " us, spinning "
+         << 100.0 * stats.Spun.count() / ( stats.Wakeups * hybrid.period().count() ) << "% of the time" << endl;
+  }
+}
+
+TEST_CASE( "Timer wheel benchmark" )
+{
+  using Wheel = fsm::TimerWheel< fsm::FSMSteadyClock >;
+
+  // many timeouts checked once per cycle, each cycle re-arms a few of them like a stream of state changes
+  const size_t timer_count = 10000;
+  const size_t cycles      = 1000;
+  const size_t rearms      = 16;
+
+  vector< fsm::SteadyTimer > polled( timer_count, fsm::SteadyTimer( 3600 ) );
+  size_t                     polled_elapsed = 0;
+  auto                       start          = chrono::steady_clock::now();
+  for ( size_t cycle = 0; cycle < cycles; cycle++ )
+  {
+    for ( auto& timer : polled )
+    {
+      polled_elapsed += timer.isElapsed() ? 1 : 0;
+    }
+    for ( size_t i = 0; i < rearms; i++ )
+    {
+      polled[( cycle * rearms + i ) % timer_count].reset();
+    }
+  }
+  const double polled_cycle = chrono::duration_cast< dseconds >( chrono::steady_clock::now() - start ).count() / cycles;
+  REQUIRE( polled_elapsed == 0 );
+
+  Wheel                  wheel( 0.001 );
+  vector< Wheel::Timer > wheeled( timer_count );
+  size_t                 wheel_elapsed = 0;
+  for ( auto& timer : wheeled )
+  {
+    wheel.arm( timer, 3600 );
+  }
+  start = chrono::steady_clock::now();
+  for ( size_t cycle = 0; cycle < cycles; cycle++ )
+  {
+    wheel_elapsed += wheel.tick();
+    for ( size_t i = 0; i < rearms; i++ )
+    {
+      wheel.arm( wheeled[( cycle * rearms + i ) % timer_count], 3600 );
+    }
+  }
+  const double wheel_cycle = chrono::duration_cast< dseconds >( chrono::steady_clock::now() - start ).count() / cycles;
+  REQUIRE( wheel_elapsed == 0 );
+
+  cout << timer_count << " timers per cycle: polled " << polled_cycle * 1e6 << " us, timer wheel " << wheel_cycle * 1e6 << " us ("
+       << polled_cycle / wheel_cycle << "x)" << endl;
+}
+
+TEST_CASE( "Cycle clock benchmark" )
+{
+  using InlineRunner = fsm::InlineFiniteStateMachineRunner< BENCHEVENT, BENCHSTATE, fsm::UnusedCommandParameter, int, fsm::FSMSteadyClock >;
+
+  const vector< fsm::EventTableEntry< BENCHEVENT, BENCHSTATE > > toggle = { { BENCHEVENT( 0 ), BENCHSTATE( 0 ), BENCHSTATE( 1 ) },
+                                                                           { BENCHEVENT( 0 ), BENCHSTATE( 1 ), BENCHSTATE( 0 ) } };
+  const size_t                                                   steps  = 200000;
+
+  // a state function checking eight timeouts, on the clock itself and on the time the runner published for the step
+  auto step_time = [&]( auto& timers ) {
+    size_t       elapsed = 0;
+    InlineRunner runner( toggle, BENCHSTATE( 0 ), 0, [&]( const fsm::UnusedCommandParameter* ) {
+      for ( auto& timer : timers )
+      {
+        elapsed += timer.isElapsed() ? 1 : 0;
+      }
+      return 0;
+    } );
+    runner.start();
+
+    const auto start = chrono::steady_clock::now();
+    for ( size_t i = 0; i < steps; i++ )
+    {
+      runner.doEventAndExecute( BENCHEVENT( 0 ) );
+    }
+    const double step = chrono::duration_cast< dseconds >( chrono::steady_clock::now() - start ).count() / steps;
+    REQUIRE( elapsed == 0 );
+    return step;
+  };
+
+  vector< fsm::SteadyTimer >                           clock_timers( 8, fsm::SteadyTimer( 3600 ) );
+  vector< fsm::BaseTimer< fsm::FSMSteadyCycleClock > > cycle_timers( 8, fsm::BaseTimer< fsm::FSMSteadyCycleClock >( 3600 ) );
+  const double                                         clock_step = step_time( clock_timers );
+  const double                                         cycle_step = step_time( cycle_timers );
+
+  cout << "step with 8 timer checks: clock " << clock_step * 1e6 << " us, cycle clock " << cycle_step * 1e6 << " us ("
+       << clock_step / cycle_step << "x)" << endl;
+}
@@ -0,0 +1,317 @@
+#define CATCH_CONFIG_MAIN
+#include <atomic>
+#include <random>
+#include <thread>
+
+#include <harmony_fsm/concurrent_finite_state_machine.hpp>
+#include <harmony_fsm/dense_finite_state_machine.hpp>
+#include <harmony_fsm/fsm_fleet.hpp>
+#include <harmony_fsm/fsm_replay.hpp>
+
+#include "catch.hpp"
+#include "stoplight.h"
+
+using namespace std;
+
+using Fleet             = fsm::FiniteStateMachineFleet< EVENT, RUNSTATE >;
+using DenseMachine      = fsm::DenseFiniteStateMachine< EVENT, RUNSTATE >;
+using ConcurrentMachine = fsm::ConcurrentFiniteStateMachine< EVENT, RUNSTATE >;
+
+template < typename TMask >
+static bool maskBit( const TMask& mask, size_t i )
+{
+  return ( mask[i / 64] >> ( i % 64 ) ) & 1;
+}
+
+// random events, including a few outside of the EVENT range
+static vector< EVENT > randomEvents( mt19937& gen, size_t count )
+{
+  uniform_int_distribution< unsigned > dist( 0, fsm::EnumTraits< EVENT >::count );
+  vector< EVENT >                      events( count );
+  for ( auto& evt : events )
+  {
+    evt = static_cast< EVENT >( dist( gen ) );
+  }
+
+  return events;
+}
+
+TEST_CASE( "Fleet per-instance events test" )
+{
+  static_assert( sizeof( Fleet::state_type ) == 1, "stoplight states should pack into a byte" );
+
+  mt19937 gen( 42 );
+
+  // odd size to exercise the scalar tail after any gather blocks
+  const size_t           count = 1000;
+  Fleet                  fleet( STOPLIGHT_FSM_TABLE, count, RUNSTATE::RED );
+  vector< DenseMachine > reference( count, DenseMachine( STOPLIGHT_FSM_TABLE, RUNSTATE::RED ) );
+
+  for ( int step = 0; step < 20; step++ )
+  {
+    const auto events = randomEvents( gen, count );
+    const auto mask   = fleet.doEvents( events );
+    REQUIRE( mask.size() == Fleet::maskWords( count ) );
+
+    for ( size_t i = 0; i < count; i++ )
+    {
+      REQUIRE( reference[i].doEvent( events[i] ) == maskBit( mask, i ) );
+      REQUIRE( reference[i].getCurrentState() == fleet.getState( i ) );
+    }
+  }
+}
+
+TEST_CASE( "Fleet partial range test" )
+{
+  const size_t count = 300;
+  Fleet        fleet( STOPLIGHT_FSM_TABLE, count, RUNSTATE::RED );
+  const auto   events = vector< EVENT >( count, EVENT::DO_NEXT_CYCLE );
+
+  // bits outside of the stepped range are left untouched
+  vector< uint64_t > mask( Fleet::maskWords( count ), ~uint64_t( 0 ) );
+  fleet.doEvents( events.data(), mask.data(), 70, 201 );
+  for ( size_t i = 0; i < count; i++ )
+  {
+    REQUIRE( fleet.getState( i ) == ( i >= 70 && i < 201 ? RUNSTATE::GREEN : RUNSTATE::RED ) );
+    REQUIRE( maskBit( mask, i ) );
+  }
+
+  fleet.setState( 5, RUNSTATE::EMERGENCY );
+  fleet.doEvents( events.data(), mask.data(), 0, 64 );
+  REQUIRE( !maskBit( mask, 5 ) );
+  REQUIRE( fleet.getState( 5 ) == RUNSTATE::EMERGENCY );
+  REQUIRE( fleet.getState( 6 ) == RUNSTATE::GREEN );
+}
+
+TEST_CASE( "Fleet addressed batch test" )
+{
+  mt19937                            gen( 3 );
+  const size_t                       count = 64;
+  Fleet                              fleet( STOPLIGHT_FSM_TABLE, count, RUNSTATE::RED );
+  vector< DenseMachine >             reference( count, DenseMachine( STOPLIGHT_FSM_TABLE, RUNSTATE::RED ) );
+  uniform_int_distribution< size_t > instance_dist( 0, count - 1 );
+  vector< fsm::FleetEvent< EVENT > > batch;
+
+  // repeated instances must be applied in batch order
+  for ( const auto evt : randomEvents( gen, 5000 ) )
+  {
+    batch.push_back( { instance_dist( gen ), evt } );
+  }
+
+  const auto mask = fleet.doEvents( batch );
+  REQUIRE( reinterpret_cast< uintptr_t >( mask.data() ) % fsm::CacheLineSize == 0 );
+  for ( size_t k = 0; k < batch.size(); k++ )
+  {
+    REQUIRE( reference[batch[k].Instance].doEvent( batch[k].Trigger ) == maskBit( mask, k ) );
+  }
+
+  for ( size_t i = 0; i < count; i++ )
+  {
+    REQUIRE( reference[i].getCurrentState() == fleet.getState( i ) );
+  }
+
+  REQUIRE_THROWS_AS( fleet.setState( 0, static_cast< RUNSTATE >( 42 ) ), std::out_of_range );
+
+  // machines past the fleet are rejected before any event of the batch is applied
+  const RUNSTATE before = fleet.getState( 0 );
+  batch                 = { { 0, EVENT::DO_NEXT_CYCLE }, { count, EVENT::DO_NEXT_CYCLE } };
+  REQUIRE_THROWS_AS( fleet.doEvents( batch ), std::out_of_range );
+  REQUIRE( fleet.getState( 0 ) == before );
+  REQUIRE_THROWS_AS( fleet.doEvent( count, EVENT::DO_NEXT_CYCLE ), std::out_of_range );
+  REQUIRE_THROWS_AS( fleet.getState( count ), std::out_of_range );
+  REQUIRE_THROWS_AS( fleet.setState( count, RUNSTATE::RED ), std::out_of_range );
+}
+
+TEST_CASE( "Thread pool test" )
+{
+  fsm::WorkStealingThreadPool pool( 4 );
+  REQUIRE( pool.size() == 4 );
+
+  // uneven tasks all complete before parallelFor returns
+  vector< atomic< int > > hits( 1000 );
+  pool.parallelFor( hits.size(), [&]( size_t i ) {
+    for ( size_t spin = 0; spin < i % 7; spin++ )
+    {
+      this_thread::yield();
+    }
+    hits[i]++;
+  } );
+
+  for ( const auto& hit : hits )
+  {
+    REQUIRE( hit == 1 );
+  }
+
+  // nested parallelFor from a worker does not deadlock
+  atomic< int > nested( 0 );
+  pool.parallelFor( 8, [&]( size_t ) { pool.parallelFor( 8, [&]( size_t ) { nested++; } ); } );
+  REQUIRE( nested == 64 );
+
+  REQUIRE_THROWS_AS( pool.parallelFor( 16,
+                                       []( size_t i ) {
+                                         if ( i == 3 )
+                                         {
+                                           throw std::runtime_error( "task failure" );
+                                         }
+                                       } ),
+                     std::runtime_error );
+}
+
+TEST_CASE( "Parallel fleet test" )
+{
+  mt19937                     gen( 11 );
+  fsm::WorkStealingThreadPool pool( 4 );
+
+  const size_t count = 100003;
+  Fleet        parallel( STOPLIGHT_FSM_TABLE, count, RUNSTATE::RED );
+  Fleet        serial( STOPLIGHT_FSM_TABLE, count, RUNSTATE::RED );
+
+  REQUIRE( reinterpret_cast< uintptr_t >( parallel.data() ) % fsm::CacheLineSize == 0 );
+  REQUIRE( parallel.chunkSize( pool.size() ) % Fleet::ChunkAlignment == 0 );
+
+  for ( int step = 0; step < 5; step++ )
+  {
+    const auto     events = randomEvents( gen, count );
+    fsm::FleetMask mask( Fleet::maskWords( count ) );
+
+    const auto stats = parallel.doEvents( pool, events.data(), mask.data() );
+    REQUIRE( stats.Events == count );
+    REQUIRE( stats.Chunks > 1 );
+    REQUIRE( stats.EventsPerSecond >= 0 );
+
+    REQUIRE( mask == serial.doEvents( events ) );
+    for ( size_t i = 0; i < count; i++ )
+    {
+      REQUIRE( parallel.getState( i ) == serial.getState( i ) );
+    }
+  }
+
+  // skewed addressed batch, most events land on the first chunk
+  vector< fsm::FleetEvent< EVENT > > batch;
+  uniform_int_distribution< size_t > hot( 0, 999 );
+  uniform_int_distribution< size_t > cold( 0, count - 1 );
+  for ( const auto evt : randomEvents( gen, 200000 ) )
+  {
+    batch.push_back( { batch.size() % 10 ? hot( gen ) : cold( gen ), evt } );
+  }
+
+  fsm::FleetMask mask( Fleet::maskWords( batch.size() ) );
+  const auto     stats = parallel.doEvents( pool, batch.data(), batch.data() + batch.size(), mask.data() );
+  REQUIRE( stats.Events == batch.size() );
+  REQUIRE( mask == serial.doEvents( batch ) );
+  for ( size_t i = 0; i < count; i++ )
+  {
+    REQUIRE( parallel.getState( i ) == serial.getState( i ) );
+  }
+
+  batch.push_back( { count, EVENT::DO_NEXT_CYCLE } );
+  REQUIRE_THROWS_AS( parallel.doEvents( pool, batch.data(), batch.data() + batch.size(), mask.data() ), std::out_of_range );
+}
+
+TEST_CASE( "Parallel replay test" )
+{
+  mt19937                                gen( 5 );
+  fsm::WorkStealingThreadPool            pool( 4 );
+  fsm::ParallelReplay< EVENT, RUNSTATE > replay( STOPLIGHT_FSM_TABLE );
+  replay.setMinChunkSize( 1000 );
+
+  // mostly cycling, with rare emergencies so start states take a while to merge
+  vector< EVENT >                      events( 250007 );
+  uniform_int_distribution< unsigned > dist( 0, 99 );
+  for ( auto& evt : events )
+  {
+    const unsigned roll = dist( gen );
+    evt                 = roll < 97 ? EVENT::DO_NEXT_CYCLE : roll < 98 ? EVENT::EMERGENCY_DECLARED : roll < 99 ? EVENT::EMERGENCY_ENDED : static_cast< EVENT >( 42 );
+  }
+
+  for ( const auto init : { RUNSTATE::RED, RUNSTATE::GREEN, RUNSTATE::EMERGENCY } )
+  {
+    DenseMachine       reference( STOPLIGHT_FSM_TABLE, init );
+    vector< RUNSTATE > expected;
+    for ( const auto evt : events )
+    {
+      reference.doEvent( evt );
+      expected.push_back( reference.getCurrentState() );
+    }
+
+    vector< RUNSTATE > states( events.size() );
+    REQUIRE( replay.replay( pool, init, events.data(), events.data() + events.size(), states.data() ) == reference.getCurrentState() );
+    REQUIRE( states == expected );
+
+    REQUIRE( replay.replay( pool, init, events.data(), events.data() + events.size() ) == reference.getCurrentState() );
+    REQUIRE( replay.replay( init, events.data(), events.data() + events.size() ) == reference.getCurrentState() );
+  }
+
+  // short streams fall back to a single chunk
+  REQUIRE( replay.replay( pool, RUNSTATE::RED, events.data(), events.data() + 3 ) == RUNSTATE::RED );
+  REQUIRE( replay.replay( pool, RUNSTATE::RED, events.data(), events.data() ) == RUNSTATE::RED );
+}
+
+TEST_CASE( "Concurrent FSM test" )
+{
+  const size_t threads    = 4;
+  const size_t iterations = 30000;
+
+  ConcurrentMachine machine( STOPLIGHT_FSM_TABLE, RUNSTATE::RED );
+  REQUIRE( machine.isLockFree() );
+
+  // every cycle event is valid from every light, none may be lost
+  atomic< size_t > succeeded( 0 );
+  vector< thread > producers;
+  for ( size_t t = 0; t < threads; t++ )
+  {
+    producers.emplace_back( [&]() {
+      for ( size_t i = 0; i < iterations; i++ )
+      {
+        RUNSTATE from_state;
+        RUNSTATE to_state;
+        if ( machine.doEvent( EVENT::DO_NEXT_CYCLE, from_state, to_state ) && to_state != from_state )
+        {
+          succeeded++;
+        }
+      }
+    } );
+  }
+  for ( auto& producer : producers )
+  {
+    producer.join();
+  }
+
+  DenseMachine expected( STOPLIGHT_FSM_TABLE, RUNSTATE::RED );
+  for ( size_t i = 0; i < threads * iterations; i++ )
+  {
+    expected.doEvent( EVENT::DO_NEXT_CYCLE );
+  }
+  REQUIRE( succeeded == threads * iterations );
+  REQUIRE( machine.getCurrentState() == expected.getCurrentState() );
+
+  // only one of the racing declarations can leave the lights
+  machine.setState( RUNSTATE::GREEN );
+  succeeded = 0;
+  producers.clear();
+  for ( size_t t = 0; t < threads; t++ )
+  {
+    producers.emplace_back( [&]() {
+      if ( machine.doEvent( EVENT::EMERGENCY_DECLARED ) )
+      {
+        succeeded++;
+      }
+    } );
+  }
+  for ( auto& producer : producers )
+  {
+    producer.join();
+  }
+  REQUIRE( succeeded == 1 );
+  REQUIRE( machine.getCurrentState() == RUNSTATE::EMERGENCY );
+
+  // a transition decided on a stale state is refused
+  REQUIRE( !machine.doEventFrom( RUNSTATE::GREEN, EVENT::DO_NEXT_CYCLE ) );
+  REQUIRE( machine.doEventFrom( RUNSTATE::EMERGENCY, EVENT::EMERGENCY_ENDED ) );
+  REQUIRE( machine.getCurrentState() == RUNSTATE::RED );
+
+  RUNSTATE next_state;
+  REQUIRE( machine.isValid( EVENT::DO_NEXT_CYCLE, next_state ) );
+  REQUIRE( next_state == RUNSTATE::GREEN );
+  REQUIRE_THROWS_AS( machine.setState( static_cast< RUNSTATE >( 7 ) ), std::out_of_range );
+}
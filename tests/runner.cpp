@@ -1,6 +1,19 @@
 #define CATCH_CONFIG_RUNNER
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include <harmony_fsm/finite_state_machine.hpp>
+#include <harmony_fsm/fsm_inline_runner.hpp>
+#include <harmony_fsm/fsm_manual_runner.hpp>
+#include <harmony_fsm/fsm_pooled_runner.hpp>
+#include <harmony_fsm/fsm_timer_wheel.hpp>
 
 #include "catch.hpp"
 #include "stoplight.h"
@@ -8,6 +21,29 @@
 using namespace std;
 using dseconds = std::chrono::duration< double >;
 
+#ifdef USE_ROS_TIME
+using TestClock = fsm::FSMROSClock;
+#else
+// the stoplight scenario runs on virtual time, sped up so that its minute of light cycles takes about a second
+using TestClock = fsm::FSMVirtualClock;
+#endif
+
+using StopLightRunner       = fsm::FiniteStateMachineRunner< EVENT, RUNSTATE, fsm::UnusedCommandParameter, RUNRESULT, TestClock >;
+using PooledStopLightRunner = fsm::PooledFiniteStateMachineRunner< EVENT, RUNSTATE, fsm::UnusedCommandParameter, RUNRESULT, TestClock >;
+
+// coarse sleep that always wakes 2 ms late, so the hybrid sleeper learns a margin longer than a 1 ms period
+int oversleeping_sleeps = 0;
+
+struct OversleepingSleeper
+{
+  template < typename TChronoClock, typename TDuration >
+  void sleepUntil( const chrono::time_point< TChronoClock, TDuration >& deadline )
+  {
+    oversleeping_sleeps++;
+    this_thread::sleep_until( deadline + chrono::milliseconds( 2 ) );
+  }
+};
+
 TEST_CASE( "rate test" )
 {
   fsm::SteadyRate rate( 10 );
@@ -23,6 +59,319 @@ TEST_CASE( "rate test" )
   REQUIRE( cnt == 10 );
 }
 
+TEST_CASE( "virtual clock test" )
+{
+  struct Tag;
+  using Clock = fsm::FSMVirtualBaseClock< Tag >;
+
+  // a stopped clock only moves by advancing and sleeping, each rate cycle ends exactly on its deadline
+  const auto              start = chrono::steady_clock::now();
+  fsm::BaseRate< Clock >  rate( 10 );
+  fsm::BaseTimer< Clock > timer( 30 );
+  int                     cnt = 0;
+  while ( !timer.isElapsed() )
+  {
+    rate.sleep();
+    cnt++;
+  }
+  REQUIRE( cnt == 300 );
+  REQUIRE( Clock::toSec() == Approx( 30 ) );
+  REQUIRE( fsm::FSMVirtualClock::toSec() == 0 );
+
+  Clock::advance( 3600 );
+  REQUIRE( Clock::toSec() == Approx( 3630 ) );
+  Clock::set( 5 );
+  REQUIRE( Clock::toSec() == 5 );
+  REQUIRE( chrono::steady_clock::now() - start < dseconds( 0.1 ) );
+
+  // a running clock passes at scale times wall time
+  Clock::setScale( 100 );
+  fsm::BaseRate< Clock > scaled( 10 );
+  for ( int i = 0; i < 10; i++ )
+  {
+    scaled.sleep();
+  }
+  Clock::setScale( 0 );
+  REQUIRE( Clock::toSec() == Approx( 6 ).margin( 0.2 ) );
+  REQUIRE( chrono::steady_clock::now() - start < dseconds( 0.5 ) );
+}
+
+TEST_CASE( "rate statistics test" )
+{
+  struct Tag;
+  using Clock = fsm::FSMVirtualBaseClock< Tag >;
+
+  // statistics are opt in and the default takes no space
+  struct PlainRate
+  {
+    chrono::nanoseconds       start, expected_cycle_time, actual_cycle_time;
+    fsm::OverrunPolicy        overrun_policy;
+    fsm::ClockSleeper< Clock > sleeper;
+  };
+  REQUIRE( sizeof( fsm::BaseRate< Clock > ) == sizeof( PlainRate ) );
+
+  // cycles of half a period, one and a half periods, half a period and three and a half periods
+  fsm::BaseRate< Clock, fsm::RateStatistics > rate( 8 );
+  for ( const double work : { 0.0625, 0.1875, 0.0, 0.4375 } )
+  {
+    Clock::advance( work );
+    rate.sleep();
+  }
+
+  auto window = rate.statistics().snapshot();
+  REQUIRE( window.Cycles == 4 );
+  REQUIRE( window.Overruns == 2 );
+  REQUIRE( window.Rephases == 1 );
+  REQUIRE( window.MaxLateness == Approx( 0.3125 ) );
+  REQUIRE( window.MeanCycleTime > 0.0625 );
+  REQUIRE( window.Histogram[4] == 2 );
+  REQUIRE( window.Histogram[12] == 1 );
+  REQUIRE( window.Histogram[fsm::RateStatistics::BucketCount - 1] == 1 );
+  REQUIRE( rate.actualCycleTime() == Approx( 0.4375 ) );
+
+  // taking a window starts the next one, readers on other threads need no lock
+  REQUIRE( rate.statistics().takeWindow().Cycles == 4 );
+  thread reader( [&]() { window = rate.statistics().snapshot(); } );
+  reader.join();
+  REQUIRE( window.Cycles == 0 );
+  REQUIRE( window.MaxLateness == 0 );
+  REQUIRE( window.MeanCycleTime > 0 );
+
+  // windows taken while the rate records split the cycles between them, never the counters of one cycle
+  fsm::RateStatistics statistics;
+  const uint64_t      recorded = 200000;
+  thread              recorder( [&]() {
+    for ( uint64_t i = 0; i < recorded; i++ )
+    {
+      statistics.recordCycle( 0.15, 0.1, 0.05 );
+    }
+  } );
+  uint64_t cycles     = 0;
+  bool     consistent = true;
+  for ( int taken = 0; taken < 10000 && cycles < recorded; taken++ )
+  {
+    const auto part     = statistics.takeWindow();
+    uint64_t   bucketed = 0;
+    for ( const uint64_t count : part.Histogram )
+    {
+      bucketed += count;
+    }
+    consistent = consistent && part.Overruns == part.Cycles && bucketed == part.Cycles;
+    cycles += part.Cycles;
+  }
+  recorder.join();
+  cycles += statistics.takeWindow().Cycles;
+  REQUIRE( consistent );
+  REQUIRE( cycles == recorded );
+}
+
+TEST_CASE( "rate overrun policies" )
+{
+  struct Tag;
+  using Clock = fsm::FSMVirtualBaseClock< Tag >;
+
+  // a cycle overruns by two and a half periods, count the sleeps that return at once before the rate sleeps again
+  auto overrun = []( fsm::OverrunPolicy policy, double work ) {
+    Clock::set( 0 );
+    fsm::BaseRate< Clock, fsm::RateStatistics > rate( 8, policy );
+    Clock::advance( work );
+
+    int immediate = 0;
+    for ( double before = Clock::toSec(); rate.sleep(), Clock::toSec() == before; immediate++ )
+    {
+    }
+    return make_pair( immediate, Clock::toSec() );
+  };
+
+  REQUIRE( overrun( fsm::OverrunPolicy::CATCH_UP, 0.4375 ) == make_pair( 3, 0.5 ) );
+  REQUIRE( overrun( fsm::OverrunPolicy::SKIP, 0.4375 ) == make_pair( 0, 0.5 ) );
+  REQUIRE( overrun( fsm::OverrunPolicy::REPHASE, 0.4375 ) == make_pair( 1, 0.5625 ) );
+  REQUIRE( overrun( fsm::OverrunPolicy::CATCH_UP_WITHIN_PERIOD, 0.4375 ) == make_pair( 1, 0.5625 ) );
+  REQUIRE( overrun( fsm::OverrunPolicy::CATCH_UP_WITHIN_PERIOD, 0.1875 ) == make_pair( 1, 0.25 ) );
+
+  // the integer rates follow the same policies
+  fsm::SteadyChronoRate skipping( chrono::milliseconds( 10 ), fsm::OverrunPolicy::SKIP );
+  this_thread::sleep_for( chrono::milliseconds( 25 ) );
+  const auto first = skipping.deadline();
+  skipping.sleep();
+  REQUIRE( skipping.deadline() - first >= chrono::milliseconds( 20 ) );
+  REQUIRE( ( skipping.deadline() - first ) % chrono::milliseconds( 10 ) == chrono::nanoseconds::zero() );
+}
+
+TEST_CASE( "chrono rate test" )
+{
+  REQUIRE( fsm::SteadyChronoRate( 10.0 ).period() == chrono::milliseconds( 100 ) );
+  REQUIRE_THROWS_AS( fsm::SteadyChronoRate( chrono::nanoseconds::zero() ), std::invalid_argument );
+  REQUIRE_THROWS_AS( fsm::SteadyChronoRate( chrono::milliseconds( -1 ) ), std::invalid_argument );
+  REQUIRE( fsm::SteadyChronoRate( 3e8 ).period() == chrono::nanoseconds( 3 ) );  // rounds to the nearest tick
+  REQUIRE_THROWS_AS( fsm::SteadyChronoRate( 3e9 ), std::invalid_argument );     // rounds to 0 ns
+  REQUIRE_THROWS_AS( fsm::SteadyChronoRate( 0.0 ), std::invalid_argument );
+  REQUIRE_THROWS_AS( fsm::SteadyChronoTimer( chrono::nanoseconds::zero() ), std::invalid_argument );
+
+  fsm::SteadyChronoRate rate( chrono::milliseconds( 100 ) );
+
+  auto start = chrono::steady_clock::now();
+  auto first = rate.deadline();
+  int  cnt   = 0;
+  while ( chrono::steady_clock::now() - start < dseconds( 1.00 ) )
+  {
+    rate.sleep();
+    cnt++;
+  }
+
+  REQUIRE( cnt == 10 );
+  REQUIRE( rate.deadline() - first == 10 * rate.period() );
+
+  // nanosecond periods stay exact where double seconds since the epoch round to hundreds of nanoseconds
+  fsm::BaseChronoRate< chrono::system_clock > fine( chrono::nanoseconds( 7 ) );
+  const double                                now_sec = fsm::FSMSystemClock::toSec();
+  REQUIRE( now_sec + 7e-9 == now_sec );
+  REQUIRE( fine.deadline() + fine.period() - fine.deadline() == chrono::nanoseconds( 7 ) );
+
+#ifdef __linux__
+  fsm::MonotonicRate monotonic( chrono::milliseconds( 100 ) );
+  start = chrono::steady_clock::now();
+  cnt   = 0;
+  while ( chrono::steady_clock::now() - start < dseconds( 1.00 ) )
+  {
+    monotonic.sleep();
+    cnt++;
+  }
+  REQUIRE( cnt == 10 );
+#endif
+
+  // the hybrid rate wakes up on time by spinning, within its spin limit
+  fsm::HybridRate hybrid( chrono::milliseconds( 1 ) );
+  hybrid.sleeper().setSpinLimit( chrono::microseconds( 300 ) );
+  for ( int i = 0; i < 100; i++ )
+  {
+    hybrid.sleep();
+  }
+  auto stats = hybrid.sleeper().stats();
+  REQUIRE( stats.Wakeups + stats.Overdue == 100 );  // a preempted cycle may find its deadline already past
+  REQUIRE( stats.Wakeups > 0 );
+  REQUIRE( stats.Margin <= chrono::microseconds( 300 ) );
+  REQUIRE( stats.MaxError >= stats.MeanError );
+
+  hybrid.sleeper().setSpinLimit( chrono::nanoseconds::zero() );
+  hybrid.sleeper().resetStats();
+  hybrid.sleep();
+  stats = hybrid.sleeper().stats();
+  REQUIRE( stats.Wakeups + stats.Overdue == 1 );
+  REQUIRE( stats.Margin == chrono::nanoseconds::zero() );
+
+  // a deadline already past is an overrun, not a late wakeup
+  const auto before = stats;
+  hybrid.sleeper().sleepUntil( chrono::steady_clock::now() - chrono::seconds( 1 ) );
+  stats = hybrid.sleeper().stats();
+  REQUIRE( stats.Wakeups == before.Wakeups );
+  REQUIRE( stats.Overdue == before.Overdue + 1 );
+  REQUIRE( stats.MaxError == before.MaxError );
+
+  // a margin beyond the period decays during spin-only sleeps until a coarse sleep probes the oversleep again,
+  // the spin time counts up to the deadline only
+  fsm::HybridSpinSleeper< OversleepingSleeper > learner( chrono::milliseconds( 10 ) );
+  chrono::nanoseconds                           requested{ 0 };
+  for ( int i = 0; i < 200; i++ )
+  {
+    const auto now = chrono::steady_clock::now();
+    learner.sleepUntil( now + chrono::milliseconds( 1 ) );
+    requested += chrono::milliseconds( 1 );
+  }
+  const auto learned = learner.stats();
+  REQUIRE( oversleeping_sleeps > 1 );
+  REQUIRE( oversleeping_sleeps < 200 );
+  REQUIRE( learned.Spun <= requested );
+
+  fsm::SteadyChronoTimer timer( chrono::milliseconds( 50 ) );
+  REQUIRE( !timer.isElapsed() );
+  this_thread::sleep_for( chrono::milliseconds( 60 ) );
+  REQUIRE( timer.isElapsed() );
+  timer.reset();
+  REQUIRE( !timer.isElapsed() );
+}
+
+TEST_CASE( "timer wheel test" )
+{
+  struct Tag;
+  using Clock = fsm::FSMVirtualBaseClock< Tag >;
+  using Wheel = fsm::TimerWheel< Clock >;
+
+  // 1/512 s is exact in double seconds and in the integer nanoseconds of the virtual clock, delays in ticks span
+  // all levels and beyond
+  const double                         tick   = 1.0 / 512;
+  const vector< double >               delays = { 1, 1.5, 255, 256, 257, 65535, 65537, 3.6e6, 2e7, 5e9 };
+  vector< double >                     fired( delays.size(), -1 );
+  vector< unique_ptr< Wheel::Timer > > timers;
+
+  Clock::set( 0 );
+  Wheel wheel( tick );
+  for ( size_t i = 0; i < delays.size(); i++ )
+  {
+    timers.emplace_back( new Wheel::Timer( [&, i] { fired[i] = wheel.now(); } ) );
+    wheel.arm( *timers.back(), delays[i] * tick );
+  }
+  REQUIRE( wheel.size() == delays.size() );
+
+  Wheel::Timer cancelled;
+  wheel.arm( cancelled, 100 * tick );
+  wheel.cancel( cancelled );
+  Wheel::Timer rearmed;
+  wheel.arm( rearmed, 100 * tick );
+  wheel.arm( rearmed, 200 * tick );
+
+  for ( int i = 1; i < 300; i++ )
+  {
+    Clock::set( i * tick );
+    wheel.tick();
+    REQUIRE( rearmed.isElapsed() == ( i >= 200 ) );
+  }
+  REQUIRE_FALSE( cancelled.isElapsed() );
+
+  // the rest expire on coarse jumps, exactly on the tick their delay rounds up to
+  for ( size_t i = 0; i < delays.size(); i++ )
+  {
+    const double due = std::ceil( delays[i] ) * tick;
+    if ( due >= 300 * tick )
+    {
+      Clock::set( due - tick );
+      REQUIRE( wheel.tick() == 0 );
+      Clock::set( due );
+      REQUIRE( wheel.tick() == 1 );
+    }
+    REQUIRE( fired[i] == due );
+  }
+  REQUIRE( wheel.size() == 0 );
+
+  // a callback re-arming its own timer expires once per period, a jump expires the due timers as one batch in
+  // which the periodic timer is re-armed from the time of the tick, once
+  Clock::set( 0 );
+  Wheel        periodic_wheel( tick );
+  int          count = 0;
+  Wheel::Timer periodic;
+  periodic.setCallback( [&] {
+    count++;
+    periodic_wheel.arm( periodic, 8 * tick );
+  } );
+  periodic_wheel.arm( periodic, 8 * tick );
+  for ( int i = 1; i <= 800; i++ )
+  {
+    Clock::set( i * tick );
+    periodic_wheel.tick();
+  }
+  REQUIRE( count == 100 );
+
+  vector< unique_ptr< Wheel::Timer > > batch;
+  for ( int i = 0; i < 1000; i++ )
+  {
+    batch.emplace_back( new Wheel::Timer() );
+    periodic_wheel.arm( *batch.back(), ( i % 50 + 1 ) * tick );
+  }
+  Clock::advance( 50 * tick );
+  REQUIRE( periodic_wheel.tick() == 1000 + 1 );
+  REQUIRE( periodic_wheel.size() == 1 );
+}
+
 #ifdef USE_ROS_TIME
 TEST_CASE( "ROS rate test" )
 {
@@ -40,7 +389,10 @@ TEST_CASE( "ROS rate test" )
 }
 #endif
 
-void run_test( bool byFuncMap )
+// running states are re-kicked from the test loop at 10 Hz, or with rekick_on_result from the completion handler
+// of a paced runner
+template < typename TRunner >
+void run_test( bool byFuncMap, TRunner& runner, bool rekick_on_result = false )
 {
   bool caughtException     = false;
   bool redCycled           = false;
@@ -55,13 +407,11 @@ void run_test( bool byFuncMap )
 
 #ifdef USE_ROS_TIME
   cout << "ROS time enabled" << endl;
-  fsm::FiniteStateMachineRunner< EVENT, RUNSTATE, fsm::UnusedCommandParameter, RUNRESULT, fsm::FSMROSClock > runner(
 #else
-  fsm::FiniteStateMachineRunner< EVENT, RUNSTATE, fsm::UnusedCommandParameter, RUNRESULT, fsm::FSMSteadyClock > runner(
+  TestClock::setScale( 50 );
 #endif
-      STOPLIGHT_FSM_TABLE, RUNSTATE::RED, RUNRESULT::CYCLE_RUNNING, 10 );
 
-  auto start = chrono::steady_clock::now();
+  auto start = TestClock::toSec();
 
   runner.setExceptionHandler( [&]( const std::exception& ex ) {
     cerr << "Exception handled: " << ex.what() << endl;
@@ -90,7 +440,7 @@ void run_test( bool byFuncMap )
 
   runner.setTimeout( 10 );
 
-  StopLightOperation operation( byFuncMap, std::move( runner ) );
+  StopLightOperation< TestClock > operation( byFuncMap, std::move( runner ), rekick_on_result );
   operation.RedExecuted       = [&]() { redCycled = true; };
   operation.YellowExecuted    = [&]() { yellowCycled = true; };
   operation.GreenExecuted     = [&]() { greenCycleCount++; };
@@ -102,10 +452,11 @@ void run_test( bool byFuncMap )
     }
   };
 
-  fsm::SteadyRate rate( 10 );
-  while ( chrono::steady_clock::now() - start < dseconds( 90 ) )
+  fsm::BaseRate< TestClock > rate( 10 );
+  while ( TestClock::toSec() - start < 90 )
   {
     rate.sleep();
+    operation.poll();
     if ( handledException && timedOut )
     {
       break;
@@ -122,7 +473,7 @@ void run_test( bool byFuncMap )
   }
 
   operation.stop();
-  cout << "Test time: " << chrono::duration_cast< dseconds >( chrono::steady_clock::now() - start ).count() << "s" << endl;
+  cout << "Test time: " << TestClock::toSec() - start << "s" << endl;
 
   REQUIRE( redCycled );
   REQUIRE( yellowCycled );
@@ -139,12 +490,887 @@ void run_test( bool byFuncMap )
 
 TEST_CASE( "runner_test_single_exec" )
 {
-  run_test( false );
+  StopLightRunner runner( STOPLIGHT_FSM_TABLE, RUNSTATE::RED, RUNRESULT::CYCLE_RUNNING, 10 );
+  run_test( false, runner );
 }
 
 TEST_CASE( "runner_test_map_exec" )
 {
-  run_test( true );
+  StopLightRunner runner( STOPLIGHT_FSM_TABLE, RUNSTATE::RED, RUNRESULT::CYCLE_RUNNING, 10 );
+  runner.setPacedCompletion( true );
+  run_test( true, runner, true );
+}
+
+TEST_CASE( "runner_test_pooled_exec" )
+{
+  fsm::RunnerExecutor   executor( 2, 10 );
+  PooledStopLightRunner runner( executor, STOPLIGHT_FSM_TABLE, RUNSTATE::RED, RUNRESULT::CYCLE_RUNNING );
+  run_test( true, runner );
+}
+
+TEST_CASE( "runner_completion_pacing" )
+{
+  using Runner = fsm::FiniteStateMachineRunner< EVENT, RUNSTATE, int, RUNRESULT, fsm::FSMSteadyClock >;
+
+  // a completion handler re-kicking a polled state runs at the runner frequency, unpaced as fast as it can
+  auto steps_in = [&]( bool paced, double seconds ) {
+    atomic< int > steps{ 0 };
+    Runner        runner( STOPLIGHT_FSM_TABLE, RUNSTATE::RED, RUNRESULT::CYCLE_RUNNING, 20, [&]( const int* ) {
+      steps++;
+      return RUNRESULT::CYCLE_RUNNING;
+    } );
+    runner.setCompletionHandler( [&]( const RUNRESULT& ) { runner.updateFSM(); } );
+    runner.setPacedCompletion( paced );
+    runner.start();
+    this_thread::sleep_for( dseconds( seconds ) );
+    runner.stop();
+    return steps.load();
+  };
+
+  const int paced = steps_in( true, 0.5 );
+  REQUIRE( paced >= 5 );
+  REQUIRE( paced <= 12 );
+  REQUIRE( steps_in( false, 0.5 ) > 100 );
+
+  // the sleeper is a policy, here spinning up to the deadline of each period
+  {
+    using HybridRunner = fsm::FiniteStateMachineRunner< EVENT, RUNSTATE, int, RUNRESULT, fsm::FSMSteadyClock, fsm::HybridSpinSleeper<> >;
+
+    atomic< int > steps{ 0 };
+    HybridRunner  runner( STOPLIGHT_FSM_TABLE, RUNSTATE::RED, RUNRESULT::CYCLE_RUNNING, 20, [&]( const int* ) {
+      steps++;
+      return RUNRESULT::CYCLE_RUNNING;
+    } );
+    runner.setCompletionHandler( [&]( const RUNRESULT& ) { runner.updateFSM(); } );
+    runner.setPacedCompletion( true );
+    runner.deliverySleeper().setSpinLimit( chrono::microseconds( 200 ) );
+    runner.start();
+    this_thread::sleep_for( chrono::milliseconds( 500 ) );
+    runner.stop();
+    REQUIRE( steps >= 5 );
+    REQUIRE( steps <= 12 );
+    REQUIRE( runner.deliverySleeper().stats().Wakeups > 0 );
+  }
+
+  // after a stall of four periods CATCH_UP delivers the missed periods back to back, SKIP keeps to the phase
+  auto bursts_after_stall = [&]( fsm::OverrunPolicy policy ) {
+    atomic< int >                              steps{ 0 };
+    mutex                                      delivered_mutex;
+    vector< chrono::steady_clock::time_point > delivered;
+    Runner                                     runner( STOPLIGHT_FSM_TABLE, RUNSTATE::RED, RUNRESULT::CYCLE_RUNNING, 20, [&]( const int* ) {
+      if ( ++steps == 3 )
+      {
+        this_thread::sleep_for( chrono::milliseconds( 200 ) );
+      }
+      return RUNRESULT::CYCLE_RUNNING;
+    } );
+    runner.setCompletionHandler( [&]( const RUNRESULT& ) {
+      {
+        lock_guard< mutex > lock( delivered_mutex );
+        delivered.push_back( chrono::steady_clock::now() );
+      }
+      runner.updateFSM();
+    } );
+    runner.setPacedCompletion( true );
+    runner.setOverrunPolicy( policy );
+    runner.start();
+    this_thread::sleep_for( chrono::milliseconds( 600 ) );
+    runner.stop();
+
+    int bursts = 0;
+    for ( size_t i = 1; i < delivered.size(); i++ )
+    {
+      bursts += delivered[i] - delivered[i - 1] < chrono::milliseconds( 10 );
+    }
+    return bursts;
+  };
+
+  REQUIRE( bursts_after_stall( fsm::OverrunPolicy::CATCH_UP ) >= 2 );
+  REQUIRE( bursts_after_stall( fsm::OverrunPolicy::SKIP ) == 0 );
+}
+
+TEST_CASE( "pooled_runners_ordering" )
+{
+  using Runner = fsm::PooledFiniteStateMachineRunner< EVENT, RUNSTATE, int, RUNRESULT, fsm::FSMSteadyClock >;
+
+  const size_t runners  = 500;
+  const int    commands = 200;
+
+  // per runner: last command seen, commands run, whether two of its state functions ever overlapped
+  struct Tally
+  {
+    atomic< int >  last{ 0 };
+    atomic< int >  count{ 0 };
+    atomic< bool > running{ false };
+    atomic< bool > overlapped{ false };
+    atomic< bool > reordered{ false };
+  };
+
+  fsm::RunnerExecutor            executor( 4 );
+  vector< Tally >                tallies( runners );
+  vector< unique_ptr< Runner > > pool;
+  for ( size_t r = 0; r < runners; r++ )
+  {
+    Tally& tally = tallies[r];
+    pool.emplace_back( new Runner( executor, STOPLIGHT_FSM_TABLE, RUNSTATE::RED, RUNRESULT::CYCLE_RUNNING, [&tally]( const int* command ) {
+      if ( tally.running.exchange( true ) )
+      {
+        tally.overlapped = true;
+      }
+      if ( *command != tally.last + 1 )
+      {
+        tally.reordered = true;
+      }
+      tally.last = *command;
+      tally.count++;
+      tally.running = false;
+      return RUNRESULT::CYCLE_RUNNING;
+    } ) );
+    pool.back()->setCommandQueue( commands, fsm::OverflowPolicy::BLOCK );
+    pool.back()->start();
+  }
+
+  // commands for all runners interleaved from two producers, each runner fed by one of them
+  vector< thread > producers;
+  for ( size_t p = 0; p < 2; p++ )
+  {
+    producers.emplace_back( [&, p]() {
+      for ( int i = 1; i <= commands; i++ )
+      {
+        for ( size_t r = p; r < runners; r += 2 )
+        {
+          pool[r]->updateFSM( int( i ) );
+        }
+      }
+    } );
+  }
+  for ( auto& producer : producers )
+  {
+    producer.join();
+  }
+
+  const auto start = chrono::steady_clock::now();
+  auto       done  = [&]() {
+    for ( const auto& tally : tallies )
+    {
+      if ( tally.count < commands )
+      {
+        return false;
+      }
+    }
+    return true;
+  };
+  while ( !done() && chrono::steady_clock::now() - start < dseconds( 20 ) )
+  {
+    this_thread::sleep_for( chrono::milliseconds( 5 ) );
+  }
+  pool.clear();
+
+  for ( const auto& tally : tallies )
+  {
+    REQUIRE( tally.count == commands );
+    REQUIRE( tally.last == commands );
+    REQUIRE( !tally.overlapped );
+    REQUIRE( !tally.reordered );
+  }
+}
+
+TEST_CASE( "runner_timeouts" )
+{
+  using Runner       = fsm::FiniteStateMachineRunner< EVENT, RUNSTATE, int, RUNRESULT, fsm::FSMSteadyClock >;
+  using PooledRunner = fsm::PooledFiniteStateMachineRunner< EVENT, RUNSTATE, int, RUNRESULT, fsm::FSMSteadyClock >;
+
+  const double timeout = 0.1;
+  const size_t runners = 200;
+  auto         respond = []( const int* ) { return RUNRESULT::CYCLE_RUNNING; };
+
+  // even runners keep responding, odd runners are never kicked and time out repeatedly
+  fsm::RunnerExecutor                  executor( 4, 20 );
+  vector< atomic< int > >              timeouts( runners );
+  vector< unique_ptr< PooledRunner > > pool;
+  for ( size_t r = 0; r < runners; r++ )
+  {
+    pool.emplace_back( new PooledRunner( executor, STOPLIGHT_FSM_TABLE, RUNSTATE::RED, RUNRESULT::CYCLE_RUNNING, respond ) );
+    pool.back()->setTimeout( timeout );
+    pool.back()->setTimeoutHandler( [&timeouts, r]( double ) { timeouts[r]++; } );
+    pool.back()->start();
+  }
+
+  // a threaded runner whose state function stalls past the timeout
+  atomic< int > stalled_timeouts{ 0 };
+  Runner        stalling( STOPLIGHT_FSM_TABLE, RUNSTATE::RED, RUNRESULT::CYCLE_RUNNING, 20, [&]( const int* ) {
+    this_thread::sleep_for( dseconds( 3 * timeout ) );
+    return RUNRESULT::CYCLE_RUNNING;
+  } );
+  stalling.setTimeout( chrono::milliseconds( 100 ) );
+  stalling.setTimeoutHandler( [&]( double ) { stalled_timeouts++; } );
+  stalling.start();
+  stalling.updateFSM( 1 );
+
+  const auto start = chrono::steady_clock::now();
+  while ( chrono::steady_clock::now() - start < dseconds( 5 * timeout ) )
+  {
+    for ( size_t r = 0; r < runners; r += 2 )
+    {
+      pool[r]->updateFSM( 1 );
+    }
+    this_thread::sleep_for( dseconds( timeout / 5 ) );
+  }
+  pool.clear();
+  stalling.stop();
+
+  for ( size_t r = 0; r < runners; r++ )
+  {
+    if ( r % 2 == 0 )
+    {
+      REQUIRE( timeouts[r] == 0 );
+    }
+    else
+    {
+      REQUIRE( timeouts[r] >= 2 );
+    }
+  }
+  REQUIRE( stalled_timeouts > 0 );
+}
+
+TEST_CASE( "runner_timeout_changes" )
+{
+  using Runner       = fsm::FiniteStateMachineRunner< EVENT, RUNSTATE, int, RUNRESULT, fsm::FSMSteadyClock >;
+  using PooledRunner = fsm::PooledFiniteStateMachineRunner< EVENT, RUNSTATE, int, RUNRESULT, fsm::FSMSteadyClock >;
+
+  // the timeout and its handler set on running runners take effect, an infinite timeout stops the handler
+  auto wait_for = []( atomic< int >& count, int target ) {
+    const auto start = chrono::steady_clock::now();
+    while ( count < target && chrono::steady_clock::now() - start < chrono::seconds( 5 ) )
+    {
+      this_thread::sleep_for( chrono::milliseconds( 5 ) );
+    }
+    return count >= target;
+  };
+
+  fsm::RunnerExecutor executor( 1, 20 );
+  Runner              threaded( STOPLIGHT_FSM_TABLE, RUNSTATE::RED, RUNRESULT::CYCLE_COMPLETE, 20 );
+  PooledRunner        pooled( executor, STOPLIGHT_FSM_TABLE, RUNSTATE::RED, RUNRESULT::CYCLE_COMPLETE );
+  atomic< int >       threaded_timeouts{ 0 };
+  atomic< int >       pooled_timeouts{ 0 };
+  threaded.start();
+  pooled.start();
+
+  threaded.setTimeout( 0.05 );
+  threaded.setTimeoutHandler( [&]( double ) { threaded_timeouts++; } );
+  pooled.setTimeoutHandler( [&]( double ) { pooled_timeouts++; } );
+  pooled.setTimeout( chrono::milliseconds( 50 ) );
+  REQUIRE( wait_for( threaded_timeouts, 2 ) );
+  REQUIRE( wait_for( pooled_timeouts, 2 ) );
+
+  threaded.setTimeout( numeric_limits< double >::infinity() );
+  this_thread::sleep_for( chrono::milliseconds( 20 ) );
+  const int stopped = threaded_timeouts;
+  this_thread::sleep_for( chrono::milliseconds( 200 ) );
+  REQUIRE( threaded_timeouts == stopped );
+
+  threaded.stop();
+  pooled.stop();
+}
+
+TEST_CASE( "timeout_supervisor_remove" )
+{
+  using Supervisor   = fsm::TimeoutSupervisor< fsm::FSMSteadyClock >;
+  using Subscription = Supervisor::Subscription;
+
+  // removed subscriptions leave the heap at once, long deadlines do not pile up across restarts
+  Supervisor                           supervisor;
+  vector< shared_ptr< Subscription > > subscriptions;
+  for ( int i = 0; i < 1000; i++ )
+  {
+    subscriptions.push_back( make_shared< Subscription >() );
+    subscriptions.back()->Deadline = fsm::FSMSteadyClock::sinceEpoch() + chrono::seconds( 3600 + i % 7 );
+    subscriptions.back()->Expired  = []() {};
+    supervisor.add( subscriptions.back() );
+  }
+  REQUIRE( supervisor.size() == 1000 );
+  for ( size_t i = 0; i < subscriptions.size(); i += 2 )
+  {
+    supervisor.remove( subscriptions[i] );
+  }
+  REQUIRE( supervisor.size() == 500 );
+  for ( size_t i = 1; i < subscriptions.size(); i += 2 )
+  {
+    supervisor.remove( subscriptions[i] );
+  }
+  REQUIRE( supervisor.size() == 0 );
+  REQUIRE( subscriptions[0].use_count() == 1 );
+
+  // removing one subscription only waits for its own handler, not for a slow handler of another
+  atomic< bool > slow_started{ false };
+  atomic< bool > slow_done{ false };
+  auto           slow = make_shared< Subscription >();
+  slow->Deadline      = fsm::FSMSteadyClock::sinceEpoch();
+  slow->Repeat        = chrono::hours( 1 );
+  slow->Expired       = [&]() {
+    slow_started = true;
+    this_thread::sleep_for( chrono::milliseconds( 300 ) );
+    slow_done = true;
+  };
+  auto other      = make_shared< Subscription >();
+  other->Deadline = fsm::FSMSteadyClock::sinceEpoch() + chrono::hours( 1 );
+  other->Expired  = []() {};
+  supervisor.add( other );
+  supervisor.add( slow );
+  while ( !slow_started )
+  {
+    this_thread::yield();
+  }
+
+  auto start = chrono::steady_clock::now();
+  supervisor.remove( other );
+  REQUIRE( chrono::steady_clock::now() - start < chrono::milliseconds( 100 ) );
+  REQUIRE_FALSE( slow_done );
+  supervisor.remove( slow );
+  REQUIRE( slow_done );
+
+  // a repeat of zero would fire back to back, it is rejected as are runner frequencies that produce one
+  auto busy    = make_shared< Subscription >();
+  busy->Repeat = chrono::nanoseconds::zero();
+  REQUIRE_THROWS_AS( supervisor.add( busy ), std::invalid_argument );
+  REQUIRE( supervisor.size() == 0 );
+  REQUIRE_THROWS_AS( fsm::RunnerExecutor( 1, 0 ), std::invalid_argument );
+  using Runner = fsm::FiniteStateMachineRunner< EVENT, RUNSTATE, int, RUNRESULT, fsm::FSMSteadyClock >;
+  REQUIRE_THROWS_AS( Runner( STOPLIGHT_FSM_TABLE, RUNSTATE::RED, RUNRESULT::CYCLE_RUNNING, -1 ), std::invalid_argument );
+}
+
+TEST_CASE( "runner_producer_blocking" )
+{
+  using Runner = fsm::FiniteStateMachineRunner< EVENT, RUNSTATE, int, RUNRESULT, fsm::FSMSteadyClock >;
+
+  const auto state_duration = chrono::milliseconds( 200 );
+
+  atomic< bool > executing( false );
+  atomic< int >  executions( 0 );
+  atomic< int >  last_command( 0 );
+
+  // a slow state function
+  Runner runner( STOPLIGHT_FSM_TABLE, RUNSTATE::RED, RUNRESULT::CYCLE_RUNNING, 10, [&]( const int* command ) {
+    executing = true;
+    this_thread::sleep_for( state_duration );
+    last_command = *command;
+    executions++;
+    executing = false;
+    return RUNRESULT::CYCLE_COMPLETE;
+  } );
+  runner.start();
+
+  runner.updateFSM( 1 );
+  while ( !executing )
+  {
+    this_thread::yield();
+  }
+
+  // producers only wait for the command hand-off, not for the state function
+  const auto start = chrono::steady_clock::now();
+  runner.updateFSM( 2 );
+  REQUIRE( runner.doEventAndExecute( EVENT::DO_NEXT_CYCLE, 3 ) );
+  REQUIRE( runner.getCurrentState() == RUNSTATE::GREEN );
+  const auto blocked = chrono::duration_cast< dseconds >( chrono::steady_clock::now() - start );
+  cout << "Producer blocked for " << blocked.count() * 1e6 << "us while a state executed" << endl;
+  REQUIRE( executing );
+  REQUIRE( blocked < state_duration / 4 );
+
+  // the command handed over while busy runs next
+  while ( executions < 2 && chrono::steady_clock::now() - start < dseconds( 5 ) )
+  {
+    this_thread::sleep_for( chrono::milliseconds( 10 ) );
+  }
+  runner.stop();
+
+  REQUIRE( executions == 2 );
+  REQUIRE( last_command == 3 );
+}
+
+TEST_CASE( "runner_locked_state_access" )
+{
+  using Runner = fsm::FiniteStateMachineRunner< EVENT, RUNSTATE, int, RUNRESULT, fsm::FSMSteadyClock >;
+
+  // batches and validity checks from another thread take the state lock the worker dispatches under
+  map< RUNSTATE, function< RUNRESULT( const int* ) > > functions;
+  atomic< int >                                        executions( 0 );
+  for ( const auto state : { RUNSTATE::RED, RUNSTATE::GREEN, RUNSTATE::YELLOW } )
+  {
+    functions[state] = [&]( const int* ) {
+      executions++;
+      return RUNRESULT::CYCLE_RUNNING;
+    };
+  }
+  Runner runner( STOPLIGHT_FSM_TABLE, RUNSTATE::RED, RUNRESULT::CYCLE_RUNNING, 10, functions );
+  runner.setCompletionHandler( [&]( const RUNRESULT& ) { runner.updateFSM(); } );
+  runner.start();
+
+  const vector< EVENT > cycle( 3, EVENT::DO_NEXT_CYCLE );
+  thread                batcher( [&]() {
+    for ( int i = 0; i < 1000; i++ )
+    {
+      runner.doEvents( cycle.data(), cycle.data() + cycle.size() );
+    }
+  } );
+  RUNSTATE next;
+  for ( int i = 0; i < 1000; i++ )
+  {
+    REQUIRE( runner.isValid( EVENT::DO_NEXT_CYCLE, next ) );
+  }
+  batcher.join();
+  runner.stop();
+
+  REQUIRE( runner.getCurrentState() == RUNSTATE::RED );
+  REQUIRE( executions > 0 );
+  REQUIRE_FALSE( runner.isValid( EVENT::EMERGENCY_ENDED, next ) );
+}
+
+TEST_CASE( "command_queue_policies" )
+{
+  fsm::BoundedCommandQueue< int > queue( 3 );
+  REQUIRE_THROWS_AS( fsm::BoundedCommandQueue< int >( 0 ), std::invalid_argument );
+
+  auto drain = [&]() {
+    vector< int > res;
+    int           value;
+    while ( queue.tryPop( value ) )
+    {
+      res.push_back( value );
+    }
+    return res;
+  };
+
+  for ( int i = 0; i < 5; i++ )
+  {
+    queue.push( int( i ), fsm::OverflowPolicy::DROP_NEWEST );
+  }
+  REQUIRE( queue.dropped() == 2 );
+  REQUIRE( drain() == vector< int >{ 0, 1, 2 } );
+  REQUIRE( queue.empty() );
+
+  for ( int i = 0; i < 5; i++ )
+  {
+    REQUIRE( queue.push( int( i ), fsm::OverflowPolicy::DROP_OLDEST ) );
+  }
+  REQUIRE( queue.dropped() == 4 );
+  REQUIRE( drain() == vector< int >{ 2, 3, 4 } );
+
+  queue.push( 1, fsm::OverflowPolicy::DROP_OLDEST );
+  queue.push( 2, fsm::OverflowPolicy::COALESCE );
+  REQUIRE( drain() == vector< int >{ 2 } );
+
+  // a blocked producer continues once the consumer makes room, or fails when the queue is closed
+  for ( int i = 0; i < 3; i++ )
+  {
+    queue.push( int( i ), fsm::OverflowPolicy::BLOCK );
+  }
+  atomic< bool > pushed( false );
+  thread         producer( [&]() { pushed = queue.push( 3, fsm::OverflowPolicy::BLOCK ); } );
+  this_thread::sleep_for( chrono::milliseconds( 20 ) );
+  REQUIRE( !pushed );
+  int value;
+  REQUIRE( queue.tryPop( value ) );
+  producer.join();
+  REQUIRE( pushed );
+  REQUIRE( drain() == vector< int >{ 1, 2, 3 } );
+
+  for ( int i = 0; i < 3; i++ )
+  {
+    queue.push( int( i ), fsm::OverflowPolicy::BLOCK );
+  }
+  producer = thread( [&]() { pushed = queue.push( 3, fsm::OverflowPolicy::BLOCK ); } );
+  this_thread::sleep_for( chrono::milliseconds( 20 ) );
+  queue.close();
+  producer.join();
+  REQUIRE( !pushed );
+
+  // a single cell is full after one push
+  fsm::BoundedCommandQueue< int > single( 1 );
+  REQUIRE( single.push( 1, fsm::OverflowPolicy::DROP_NEWEST ) );
+  REQUIRE_FALSE( single.push( 2, fsm::OverflowPolicy::DROP_NEWEST ) );
+  REQUIRE( single.tryPop( value ) );
+  REQUIRE( value == 1 );
+  REQUIRE( single.push( 3, fsm::OverflowPolicy::DROP_OLDEST ) );
+  REQUIRE( single.push( 4, fsm::OverflowPolicy::DROP_OLDEST ) );
+  REQUIRE( single.tryPop( value ) );
+  REQUIRE( value == 4 );
+  REQUIRE_FALSE( single.tryPop( value ) );
+  REQUIRE( single.dropped() == 2 );
+}
+
+TEST_CASE( "runner_command_bursts" )
+{
+  using Runner = fsm::FiniteStateMachineRunner< EVENT, RUNSTATE, int, RUNRESULT, fsm::FSMSteadyClock >;
+
+  const int producers = 4;
+  const int commands  = 5000;
+
+  atomic< int >       executions( 0 );
+  atomic< int >       refused( 0 );
+  atomic< long long > total( 0 );
+
+  Runner runner( STOPLIGHT_FSM_TABLE, RUNSTATE::RED, RUNRESULT::CYCLE_RUNNING, 10, [&]( const int* command ) {
+    total += *command;
+    executions++;
+    return RUNRESULT::CYCLE_RUNNING;
+  } );
+  runner.setCommandQueue( 64, fsm::OverflowPolicy::BLOCK );
+  runner.start();
+
+  // bursts from several threads, none may be lost
+  vector< thread > threads;
+  for ( int t = 0; t < producers; t++ )
+  {
+    threads.emplace_back( [&, t]() {
+      for ( int i = 1; i <= commands; i++ )
+      {
+        if ( !runner.updateFSM( t * commands + i ) )
+        {
+          refused++;
+        }
+      }
+    } );
+  }
+  for ( auto& producer : threads )
+  {
+    producer.join();
+  }
+
+  const auto start = chrono::steady_clock::now();
+  while ( executions < producers * commands && chrono::steady_clock::now() - start < dseconds( 10 ) )
+  {
+    this_thread::sleep_for( chrono::milliseconds( 1 ) );
+  }
+  runner.stop();
+
+  const long long count = producers * commands;
+  REQUIRE( refused == 0 );
+  REQUIRE( executions == count );
+  REQUIRE( total == count * ( count + 1 ) / 2 );
+  REQUIRE( runner.droppedCommands() == 0 );
+}
+
+TEST_CASE( "runner_queued_transitions" )
+{
+  using Runner = fsm::FiniteStateMachineRunner< EVENT, RUNSTATE, int, RUNRESULT, fsm::FSMSteadyClock >;
+
+  // each state function records its state and command, the first one waits until the queue is filled
+  mutex                                                ran_mutex;
+  vector< pair< RUNSTATE, int > >                      ran;
+  atomic< bool >                                       started( false );
+  atomic< bool >                                       release( false );
+  map< RUNSTATE, function< RUNRESULT( const int* ) > > functions;
+  for ( const auto state : { RUNSTATE::RED, RUNSTATE::GREEN, RUNSTATE::YELLOW } )
+  {
+    functions[state] = [&, state]( const int* command ) {
+      started = true;
+      while ( !release )
+      {
+        this_thread::yield();
+      }
+      lock_guard< mutex > lock( ran_mutex );
+      ran.emplace_back( state, *command );
+      return RUNRESULT::CYCLE_RUNNING;
+    };
+  }
+
+  auto wait_for = [&]( size_t count ) {
+    const auto start = chrono::steady_clock::now();
+    for ( ;; )
+    {
+      {
+        lock_guard< mutex > lock( ran_mutex );
+        if ( ran.size() >= count || chrono::steady_clock::now() - start > dseconds( 5 ) )
+        {
+          return ran;
+        }
+      }
+      this_thread::sleep_for( chrono::milliseconds( 1 ) );
+    }
+  };
+
+  // commands queued with a transition run the function of the state they transitioned to, a kick queues behind
+  // them and runs the state current when it is popped
+  Runner runner( STOPLIGHT_FSM_TABLE, RUNSTATE::RED, RUNRESULT::CYCLE_RUNNING, 10, functions );
+  runner.setCommandQueue( 8, fsm::OverflowPolicy::BLOCK );
+  runner.start();
+  runner.updateFSM( 1 );
+  while ( !started )
+  {
+    this_thread::yield();
+  }
+  const bool to_green  = runner.doEventAndExecute( EVENT::DO_NEXT_CYCLE, 2 );
+  const bool to_yellow = runner.doEventAndExecute( EVENT::DO_NEXT_CYCLE, 3 );
+  const bool kicked    = runner.updateFSM();
+  release              = true;
+  REQUIRE( to_green );
+  REQUIRE( to_yellow );
+  REQUIRE( kicked );
+  const vector< pair< RUNSTATE, int > > expected = {
+    { RUNSTATE::RED, 1 }, { RUNSTATE::GREEN, 2 }, { RUNSTATE::YELLOW, 3 }, { RUNSTATE::YELLOW, 3 } };
+  REQUIRE( wait_for( expected.size() ) == expected );
+  runner.stop();
+  REQUIRE( runner.droppedCommands() == 0 );
+
+  // a kick that finds the queue full is dropped and counted rather than reported as queued
+  ran.clear();
+  started = false;
+  release = false;
+  Runner dropping( STOPLIGHT_FSM_TABLE, RUNSTATE::RED, RUNRESULT::CYCLE_RUNNING, 10, functions );
+  dropping.setCommandQueue( 1, fsm::OverflowPolicy::DROP_NEWEST );
+  dropping.start();
+  dropping.updateFSM( 1 );
+  while ( !started )
+  {
+    this_thread::yield();
+  }
+  const bool queued  = dropping.updateFSM( 2 );
+  const bool dropped = !dropping.updateFSM();
+  release            = true;
+  REQUIRE( queued );
+  REQUIRE( dropped );
+  REQUIRE( dropping.droppedCommands() == 1 );
+  REQUIRE( wait_for( 2 ).size() == 2 );
+  dropping.stop();
+}
+
+TEST_CASE( "runner_test_inline_exec" )
+{
+  using Runner = fsm::InlineFiniteStateMachineRunner< EVENT, RUNSTATE, int, RUNRESULT, fsm::FSMSteadyClock >;
+
+  const int cycles = 9;
+
+  vector< RUNSTATE > executed;
+  int                depth       = 0;
+  int                max_depth   = 0;
+  int                pre_execs   = 0;
+  bool               timed_out   = false;
+  bool               handled     = false;
+  bool               same_thread = true;
+  const auto         caller      = this_thread::get_id();
+
+  Runner runner( STOPLIGHT_FSM_TABLE, RUNSTATE::RED, RUNRESULT::CYCLE_COMPLETE );
+  runner.setExecFunction( [&]( const int* command ) {
+    same_thread = same_thread && this_thread::get_id() == caller;
+    executed.push_back( runner.getCurrentState() );
+    if ( *command == cycles )
+    {
+      this_thread::sleep_for( chrono::milliseconds( 30 ) );
+    }
+    else if ( *command > cycles )
+    {
+      throw runtime_error( "Testing exception handler" );
+    }
+    return RUNRESULT::CYCLE_COMPLETE;
+  } );
+  runner.setPreExecFunction( [&]( const int* ) { pre_execs++; } );
+
+  // every completion kicks the next cycle, which runs once this handler has returned
+  int next = 1;
+  runner.setCompletionHandler( [&]( const RUNRESULT& ) {
+    max_depth = max( max_depth, ++depth );
+    if ( next <= cycles )
+    {
+      REQUIRE( runner.doEventAndExecute( EVENT::DO_NEXT_CYCLE, int( next++ ) ) );
+    }
+    depth--;
+  } );
+  runner.setTimeout( 0.01 );
+  runner.setTimeoutHandler( [&]( double ) { timed_out = true; } );
+  runner.setExceptionHandler( [&]( const std::exception& ) { handled = true; } );
+
+  // the whole chain runs on this thread before start returns
+  runner.start();
+  REQUIRE( same_thread );
+  REQUIRE( max_depth == 1 );
+  REQUIRE( pre_execs == cycles );
+  REQUIRE( executed.size() == size_t( cycles ) );
+  for ( int i = 0; i < cycles; i++ )
+  {
+    REQUIRE( executed[i] == vector< RUNSTATE >{ RUNSTATE::GREEN, RUNSTATE::YELLOW, RUNSTATE::RED }[i % 3] );
+  }
+  REQUIRE( timed_out );
+  REQUIRE( runner.getCurrentState() == RUNSTATE::RED );
+
+  // an exception halts the runner until it is started again
+  REQUIRE( runner.updateFSM( cycles + 1 ) );
+  REQUIRE( handled );
+  REQUIRE( runner.updateFSM( 1 ) );
+  REQUIRE( executed.size() == size_t( cycles + 1 ) );
+}
+
+TEST_CASE( "runner_test_manual_tick" )
+{
+  using Runner = fsm::ManualFiniteStateMachineRunner< EVENT, RUNSTATE, int, RUNRESULT, fsm::FSMSteadyClock >;
+
+  // a stoplight on simulated time: each light holds for its duration, then the completion handler moves on
+  const map< RUNSTATE, double > durations = { { RUNSTATE::GREEN, 5 }, { RUNSTATE::YELLOW, 3 }, { RUNSTATE::RED, 5 } };
+  const double                  period    = 0.01;
+  const size_t                  ticks     = 360000;  // one simulated hour
+
+  struct Simulation
+  {
+    double                             now     = 0;
+    double                             entered = 0;
+    vector< pair< RUNSTATE, double > > completions;
+    vector< double >                   timeouts;
+    unique_ptr< Runner >               runner;
+  };
+
+  auto simulate = [&]( Simulation& sim, size_t count ) {
+    sim.runner.reset( new Runner( STOPLIGHT_FSM_TABLE, RUNSTATE::RED, RUNRESULT::CYCLE_COMPLETE ) );
+    sim.runner->setExecFunction( [&]( const int* ) {
+      return sim.now - sim.entered >= durations.at( sim.runner->getCurrentState() ) ? RUNRESULT::CYCLE_COMPLETE : RUNRESULT::CYCLE_RUNNING;
+    } );
+    sim.runner->setCompletionHandler( [&]( const RUNRESULT& result ) {
+      if ( result == RUNRESULT::CYCLE_COMPLETE )
+      {
+        sim.completions.emplace_back( sim.runner->getCurrentState(), sim.now );
+        sim.entered = sim.now;
+        sim.runner->doEventAndExecute( EVENT::DO_NEXT_CYCLE, 0 );
+      }
+      else
+      {
+        sim.runner->updateFSM();
+      }
+    } );
+    sim.runner->setTimeout( 0.5 );
+    sim.runner->setTimeoutHandler( [&]( double last_response ) { sim.timeouts.push_back( last_response ); } );
+    sim.runner->start( sim.now );
+
+    for ( size_t i = 0; i < count; i++ )
+    {
+      sim.runner->tick( sim.now );
+      sim.now += period;
+    }
+  };
+
+  const auto start = chrono::steady_clock::now();
+  Simulation first;
+  simulate( first, ticks );
+  const double elapsed = chrono::duration_cast< dseconds >( chrono::steady_clock::now() - start ).count();
+  cout << "Simulated " << first.now << "s in " << elapsed << "s" << endl;
+
+  // one light change per 13 s cycle, in order, and never a timeout while the lights keep responding
+  REQUIRE( first.completions.size() == size_t( first.now / 13 * 3 ) );
+  REQUIRE( first.completions[0].first == RUNSTATE::RED );
+  REQUIRE( first.completions[1].first == RUNSTATE::GREEN );
+  REQUIRE( first.completions[2].first == RUNSTATE::YELLOW );
+  REQUIRE( first.timeouts.empty() );
+  REQUIRE( elapsed < first.now / 100 );
+
+  // the same ticks give the same results, also when batches of runners are ticked in parallel
+  fsm::WorkStealingThreadPool batch( 4 );
+  vector< Simulation >        sims( 16 );
+  batch.parallelFor( sims.size(), [&]( size_t i ) { simulate( sims[i], ticks / 10 ); } );
+  for ( auto& sim : sims )
+  {
+    REQUIRE( sim.completions == vector< pair< RUNSTATE, double > >( first.completions.begin(),
+                                                                    first.completions.begin() + sim.completions.size() ) );
+  }
+
+  // without kicks the timeout handler is called on every tick past the timeout, with the last response time
+  Simulation& stalled = sims[0];
+  stalled.runner->setCompletionHandler( nullptr );
+  stalled.runner->updateFSM();
+  const double last_response = stalled.now;
+  REQUIRE( stalled.runner->tick( stalled.now ) == 1 );
+  for ( int i = 1; i <= 10; i++ )
+  {
+    REQUIRE( stalled.runner->tick( last_response + i * 0.07 ) == 0 );
+  }
+  REQUIRE( stalled.timeouts.size() == 3 );
+  for ( const double timeout : stalled.timeouts )
+  {
+    REQUIRE( timeout == Approx( last_response ) );  // ticks are supervised in integer nanoseconds
+  }
+}
+
+TEST_CASE( "runner_cycle_clock" )
+{
+  struct Tag;
+  using Clock      = fsm::FSMVirtualBaseClock< Tag >;
+  using CycleClock = fsm::FSMCycleBaseClock< Clock >;
+  using Runner     = fsm::ManualFiniteStateMachineRunner< EVENT, RUNSTATE, int, RUNRESULT, Clock >;
+
+  // outside a step the cycle clock reads its clock, scopes nest
+  Clock::set( 1 );
+  REQUIRE_FALSE( CycleClock::published() );
+  REQUIRE( CycleClock::toSec() == 1 );
+  {
+    CycleClock::Scope outer( 2 );
+    {
+      CycleClock::Scope inner( 3 );
+      REQUIRE( CycleClock::toSec() == 3 );
+    }
+    REQUIRE( CycleClock::toSec() == 2 );
+  }
+  REQUIRE_FALSE( CycleClock::published() );
+
+  // the state function sees the time of the tick however often it reads, even while the clock moves
+  Clock::set( 0 );
+  fsm::BaseTimer< CycleClock > timer( 1 );
+  vector< double >             seen;
+  vector< bool >               elapsed;
+  Runner                       runner( STOPLIGHT_FSM_TABLE, RUNSTATE::RED, RUNRESULT::CYCLE_RUNNING );
+  runner.setExecFunction( [&]( const int* ) {
+    seen.push_back( CycleClock::toSec() );
+    Clock::advance( 0.25 );
+    seen.push_back( CycleClock::toSec() );
+    elapsed.push_back( timer.isElapsed() );
+    return RUNRESULT::CYCLE_RUNNING;
+  } );
+  runner.setCompletionHandler( [&]( const RUNRESULT& ) { runner.updateFSM(); } );
+  runner.start( 0 );
+  for ( double now : { 0.5, 1.0, 1.5 } )
+  {
+    runner.tick( now );
+    REQUIRE( runner.cycleTime() == now );
+  }
+  REQUIRE( seen == vector< double >{ 0.5, 0.5, 1.0, 1.0, 1.5, 1.5 } );
+  REQUIRE( elapsed == vector< bool >{ false, true, true } );
+  REQUIRE( CycleClock::toSec() == Clock::toSec() );
+
+  // threaded runners publish the step on their worker, the timeout handler gets the time of the supervisor
+  using ThreadedRunner = fsm::FiniteStateMachineRunner< EVENT, RUNSTATE, int, RUNRESULT, fsm::FSMSteadyClock >;
+  using SteadyCycle    = fsm::FSMSteadyCycleClock;
+  atomic< int >  steps{ 0 };
+  atomic< bool > consistent{ true };
+  atomic< bool > timed_out{ false };
+  ThreadedRunner threaded( STOPLIGHT_FSM_TABLE, RUNSTATE::RED, RUNRESULT::CYCLE_RUNNING, 100 );
+  threaded.setExecFunction( [&]( const int* ) {
+    const double now = SteadyCycle::toSec();
+    this_thread::sleep_for( chrono::milliseconds( 1 ) );
+    if ( !SteadyCycle::published() || SteadyCycle::toSec() != now || threaded.cycleTime() != now )
+    {
+      consistent = false;
+    }
+    steps++;
+    return RUNRESULT::CYCLE_RUNNING;
+  } );
+  threaded.setCompletionHandler( [&]( const RUNRESULT& ) {
+    if ( steps < 5 )
+    {
+      threaded.updateFSM();
+    }
+  } );
+  threaded.setTimeout( 0.05 );
+  threaded.setTimeoutHandler( [&]( double ) {
+    if ( SteadyCycle::published() && SteadyCycle::toSec() == SteadyCycle::toSec() )
+    {
+      timed_out = true;
+    }
+  } );
+  threaded.start();
+  const auto start = chrono::steady_clock::now();
+  while ( !timed_out && chrono::steady_clock::now() - start < chrono::seconds( 5 ) )
+  {
+    this_thread::sleep_for( chrono::milliseconds( 10 ) );
+  }
+  threaded.stop();
+  REQUIRE( steps == 5 );
+  REQUIRE( consistent );
+  REQUIRE( timed_out );
 }
 
 int main (int argc, char * argv[]) 
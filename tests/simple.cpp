@@ -1,7 +1,10 @@
 #define CATCH_CONFIG_MAIN
 #include <chrono>
 
+#include <harmony_fsm/concurrent_finite_state_machine.hpp>
 #include <harmony_fsm/finite_state_machine.hpp>
+#include <harmony_fsm/dense_finite_state_machine.hpp>
+#include <harmony_fsm/static_finite_state_machine.hpp>
 #include <harmony_fsm/config_parser.hpp>
 
 #include "catch.hpp"
@@ -9,7 +12,8 @@
 
 using namespace std;
 
-void basic_test( fsm::FiniteStateMachine< EVENT, RUNSTATE >& machine )
+template < typename TMachine >
+void basic_test( TMachine& machine )
 {
   // this is an improper, undefined transition and should fail
   REQUIRE( machine.doEvent( EVENT::EMERGENCY_ENDED ) == false );
@@ -37,6 +41,253 @@ TEST_CASE( "FSM test" )
   basic_test( machine_from_table );
 }
 
+TEST_CASE( "Dense FSM test" )
+{
+  fsm::DenseFiniteStateMachine< EVENT, RUNSTATE > machine_from_table( STOPLIGHT_FSM_TABLE, RUNSTATE::RED );
+  basic_test( machine_from_table );
+
+  fsm::DenseFiniteStateMachine< EVENT, RUNSTATE > machine_from_map( STOPLIGHT_FSM_MAP, RUNSTATE::RED );
+  basic_test( machine_from_map );
+
+  // every state/event combination agrees with the map based machine
+  for ( unsigned s = 0; s < fsm::EnumTraits< RUNSTATE >::count; s++ )
+  {
+    for ( unsigned e = 0; e < fsm::EnumTraits< EVENT >::count; e++ )
+    {
+      fsm::FiniteStateMachine< EVENT, RUNSTATE >      reference( STOPLIGHT_FSM_TABLE, static_cast< RUNSTATE >( s ) );
+      fsm::DenseFiniteStateMachine< EVENT, RUNSTATE > dense( STOPLIGHT_FSM_TABLE, static_cast< RUNSTATE >( s ) );
+      REQUIRE( reference.doEvent( static_cast< EVENT >( e ) ) == dense.doEvent( static_cast< EVENT >( e ) ) );
+      REQUIRE( reference.getCurrentState() == dense.getCurrentState() );
+    }
+  }
+
+  // out of range events are rejected rather than read past the table
+  REQUIRE( machine_from_table.doEvent( static_cast< EVENT >( 42 ) ) == false );
+  REQUIRE( machine_from_table.getCurrentState() == RUNSTATE::RED );
+}
+
+TEST_CASE( "Shared table test" )
+{
+  using Machine      = fsm::FiniteStateMachine< EVENT, RUNSTATE >;
+  using DenseMachine = fsm::DenseFiniteStateMachine< EVENT, RUNSTATE >;
+
+  // refcounted, built once for every instance
+  auto table = fsm::makeSharedTable< Machine::TransitionMap >( Machine::buildTransitionMap( STOPLIGHT_FSM_TABLE ) );
+  std::vector< Machine > machines( 100, Machine( table, RUNSTATE::RED ) );
+  REQUIRE( table.use_count() == 101 );
+
+  machines[0].doEvent( EVENT::DO_NEXT_CYCLE );
+  REQUIRE( machines[0].getCurrentState() == RUNSTATE::GREEN );
+  REQUIRE( machines[1].getCurrentState() == RUNSTATE::RED );
+  basic_test( machines[1] );
+
+  // copies share the table instead of cloning it
+  Machine copy( machines[0] );
+  REQUIRE( &copy.getTransitionTable() == table.get() );
+  REQUIRE( copy.getCurrentState() == RUNSTATE::GREEN );
+
+  auto dense_table = fsm::makeSharedTable< DenseMachine::TransitionTable >( STOPLIGHT_FSM_TABLE );
+  DenseMachine dense( dense_table, RUNSTATE::RED );
+  DenseMachine dense_copy( dense );
+  REQUIRE( &dense_copy.getTransitionTable() == dense_table.get() );
+  REQUIRE( sizeof( DenseMachine ) <= sizeof( std::shared_ptr< void > ) + sizeof( RUNSTATE ) + alignof( std::shared_ptr< void > ) );
+  basic_test( dense_copy );
+
+  // borrowed, no reference count is taken
+  static const DenseMachine::TransitionTable static_table( STOPLIGHT_FSM_TABLE );
+  DenseMachine borrowed( fsm::borrowTable( static_table ), RUNSTATE::RED );
+  REQUIRE( &borrowed.getTransitionTable() == &static_table );
+  REQUIRE( borrowed.getSharedTransitionTable().use_count() == 0 );
+  basic_test( borrowed );
+}
+
+TEST_CASE( "Static FSM test" )
+{
+  using StopLightMachine = fsm::StaticFiniteStateMachine< EVENT, RUNSTATE, STOPLIGHT_FSM_ARRAY.size(), STOPLIGHT_FSM_ARRAY >;
+
+  // the machine is only its current state
+  static_assert( sizeof( StopLightMachine ) == sizeof( RUNSTATE ), "static machine should not carry a table" );
+
+  // the table is usable in constant expressions
+  static_assert( StopLightMachine( RUNSTATE::EMERGENCY ).getCurrentState() == RUNSTATE::EMERGENCY, "constexpr construction" );
+  static_assert( !fsm::detail::hasDuplicateTransitions( STOPLIGHT_FSM_ARRAY ), "stoplight table has no duplicates" );
+
+  StopLightMachine machine( RUNSTATE::RED );
+  basic_test( machine );
+
+  for ( const auto& entry : STOPLIGHT_FSM_TABLE )
+  {
+    RUNSTATE next = RUNSTATE::RED;
+    REQUIRE( StopLightMachine::lookup( entry.Current, entry.Trigger, next ) );
+    REQUIRE( next == entry.Result );
+  }
+
+  REQUIRE( machine.doEvent( static_cast< EVENT >( 42 ) ) == false );
+  REQUIRE_THROWS_AS( StopLightMachine( static_cast< RUNSTATE >( 42 ) ), std::out_of_range );
+}
+
+static constexpr std::array< fsm::EventTableEntry< EVENT, RUNSTATE >, 2 > DUPLICATE_FSM_ARRAY = { {
+    { EVENT::DO_NEXT_CYCLE, RUNSTATE::GREEN, RUNSTATE::YELLOW },
+    { EVENT::DO_NEXT_CYCLE, RUNSTATE::GREEN, RUNSTATE::RED } } };
+
+// instantiating a StaticFiniteStateMachine on this table fails to compile
+static_assert( fsm::detail::hasDuplicateTransitions( DUPLICATE_FSM_ARRAY ), "duplicate rows should be detected" );
+
+TEST_CASE( "Interleaved stepping test" )
+{
+  using DenseMachine = fsm::DenseFiniteStateMachine< EVENT, RUNSTATE >;
+
+  // streams of different lengths, including an empty one and invalid events
+  std::vector< std::vector< EVENT > > streams;
+  for ( size_t i = 0; i < 11; i++ )
+  {
+    std::vector< EVENT > stream;
+    for ( size_t k = 0; k < i * 37; k++ )
+    {
+      stream.push_back( static_cast< EVENT >( ( k * 7 + i ) % 4 ) );
+    }
+    streams.push_back( stream );
+  }
+
+  std::vector< DenseMachine >              reference( streams.size(), DenseMachine( STOPLIGHT_FSM_TABLE, RUNSTATE::RED ) );
+  std::vector< DenseMachine >              machines( streams.size(), DenseMachine( STOPLIGHT_FSM_TABLE, RUNSTATE::RED ) );
+  std::vector< DenseMachine::EventStream > ranges;
+  size_t                                   expected_valid = 0;
+  for ( size_t i = 0; i < streams.size(); i++ )
+  {
+    ranges.push_back( { streams[i].data(), streams[i].data() + streams[i].size() } );
+    for ( const auto evt : streams[i] )
+    {
+      expected_valid += reference[i].doEvent( evt );
+    }
+  }
+
+  REQUIRE( DenseMachine::stepInterleaved< 4 >( machines.data(), ranges.data(), ranges.size() ) == expected_valid );
+  for ( size_t i = 0; i < streams.size(); i++ )
+  {
+    REQUIRE( machines[i].getCurrentState() == reference[i].getCurrentState() );
+  }
+}
+
+template < typename TMachine >
+void batch_test( TMachine machine )
+{
+  const std::vector< EVENT > events = { EVENT::DO_NEXT_CYCLE, EVENT::DO_NEXT_CYCLE, EVENT::EMERGENCY_ENDED, EVENT::DO_NEXT_CYCLE };
+  std::vector< RUNSTATE >    states( events.size(), RUNSTATE::EMERGENCY );
+
+  // stop at the invalid EMERGENCY_ENDED, from RED
+  auto stop = machine;
+  auto res  = stop.doEvents( events.data(), events.data() + events.size(), fsm::BatchPolicy::STOP_AT_INVALID, states.data() );
+  REQUIRE( res.Index == 2 );
+  REQUIRE( res.State == RUNSTATE::YELLOW );
+  REQUIRE( stop.getCurrentState() == RUNSTATE::YELLOW );
+  REQUIRE( states == std::vector< RUNSTATE >{ RUNSTATE::GREEN, RUNSTATE::YELLOW, RUNSTATE::EMERGENCY, RUNSTATE::EMERGENCY } );
+
+  // skip it and carry on
+  auto skip = machine;
+  res       = skip.doEvents( events.data(), events.data() + events.size(), fsm::BatchPolicy::SKIP_INVALID, states.data() );
+  REQUIRE( res.Index == events.size() );
+  REQUIRE( res.State == RUNSTATE::RED );
+  REQUIRE( skip.getCurrentState() == RUNSTATE::RED );
+  REQUIRE( states == std::vector< RUNSTATE >{ RUNSTATE::GREEN, RUNSTATE::YELLOW, RUNSTATE::YELLOW, RUNSTATE::RED } );
+
+  // reject the whole batch
+  auto atomic = machine;
+  atomic.doEvent( EVENT::DO_NEXT_CYCLE );
+  res = atomic.doEvents( events.data(), events.data() + events.size(), fsm::BatchPolicy::ATOMIC );
+  REQUIRE( res.Index == 2 );
+  REQUIRE( res.State == RUNSTATE::GREEN );
+  REQUIRE( atomic.getCurrentState() == RUNSTATE::GREEN );
+
+  res = atomic.doEvents( events.data(), events.data() + 2, fsm::BatchPolicy::ATOMIC );
+  REQUIRE( res.Index == 2 );
+  REQUIRE( atomic.getCurrentState() == RUNSTATE::RED );
+
+  res = atomic.doEvents( events.data(), events.data() );
+  REQUIRE( res.Index == 0 );
+  REQUIRE( res.State == RUNSTATE::RED );
+}
+
+TEST_CASE( "Batch events test" )
+{
+  batch_test( fsm::FiniteStateMachine< EVENT, RUNSTATE >( STOPLIGHT_FSM_TABLE, RUNSTATE::RED ) );
+  batch_test( fsm::DenseFiniteStateMachine< EVENT, RUNSTATE >( STOPLIGHT_FSM_TABLE, RUNSTATE::RED ) );
+  batch_test( fsm::StaticFiniteStateMachine< EVENT, RUNSTATE, STOPLIGHT_FSM_ARRAY.size(), STOPLIGHT_FSM_ARRAY >( RUNSTATE::RED ) );
+}
+
+// the precomputed sets agree with the stoplight rules for every state and event
+template < typename TMachine >
+void valid_events_test( TMachine machine )
+{
+  const auto& events = machine.validEvents();
+  REQUIRE( events.count() == 2 );
+  REQUIRE( events.test( EVENT::DO_NEXT_CYCLE ) );
+  REQUIRE( events.test( EVENT::EMERGENCY_DECLARED ) );
+  REQUIRE( !events.test( EVENT::EMERGENCY_ENDED ) );
+
+  std::vector< EVENT > listed( events.begin(), events.end() );
+  REQUIRE( listed == std::vector< EVENT >{ EVENT::DO_NEXT_CYCLE, EVENT::EMERGENCY_DECLARED } );
+
+  std::vector< RUNSTATE > next( machine.nextStates().begin(), machine.nextStates().end() );
+  REQUIRE( next == std::vector< RUNSTATE >{ RUNSTATE::GREEN, RUNSTATE::EMERGENCY } );
+
+  for ( unsigned s = 0; s < fsm::EnumTraits< RUNSTATE >::count; s++ )
+  {
+    const auto  state   = static_cast< RUNSTATE >( s );
+    const auto& mapping = STOPLIGHT_FSM_MAP.at( state );
+    REQUIRE( machine.validEventsFrom( state ).count() == mapping.size() );
+    for ( const auto& event_mapping : mapping )
+    {
+      REQUIRE( machine.validEventsFrom( state ).test( event_mapping.first ) );
+      REQUIRE( machine.nextStatesFrom( state ).test( event_mapping.second ) );
+    }
+  }
+
+  REQUIRE( machine.validEventsFrom( static_cast< RUNSTATE >( 42 ) ).none() );
+  REQUIRE( machine.nextStatesFrom( static_cast< RUNSTATE >( 42 ) ).none() );
+}
+
+TEST_CASE( "Valid events test" )
+{
+  valid_events_test( fsm::DenseFiniteStateMachine< EVENT, RUNSTATE >( STOPLIGHT_FSM_TABLE, RUNSTATE::RED ) );
+  valid_events_test( fsm::ConcurrentFiniteStateMachine< EVENT, RUNSTATE >( STOPLIGHT_FSM_TABLE, RUNSTATE::RED ) );
+  valid_events_test( fsm::StaticFiniteStateMachine< EVENT, RUNSTATE, STOPLIGHT_FSM_ARRAY.size(), STOPLIGHT_FSM_ARRAY >( RUNSTATE::RED ) );
+}
+
+enum class DOOREVENT : uint8_t
+{
+  OPEN,
+  CLOSE,
+  COUNT
+};
+
+enum class DOORSTATE : uint16_t
+{
+  OPENED,
+  CLOSED,
+  COUNT
+};
+
+TEST_CASE( "Dense FSM COUNT sentinel test" )
+{
+  static_assert( fsm::EnumTraits< DOORSTATE >::count == 2, "COUNT sentinel should size the state range" );
+  static_assert( std::is_same< fsm::DenseTransitionTable< DOOREVENT, DOORSTATE >::code_type, uint8_t >::value,
+                 "codes should use the smallest type that fits" );
+
+  fsm::DenseFiniteStateMachine< DOOREVENT, DOORSTATE > door(
+      { { DOOREVENT::OPEN, DOORSTATE::CLOSED, DOORSTATE::OPENED }, { DOOREVENT::CLOSE, DOORSTATE::OPENED, DOORSTATE::CLOSED } },
+      DOORSTATE::CLOSED );
+
+  REQUIRE( door.doEvent( DOOREVENT::CLOSE ) == false );
+  REQUIRE( door.doEvent( DOOREVENT::OPEN ) == true );
+  REQUIRE( door.getCurrentState() == DOORSTATE::OPENED );
+
+  // rows outside of the enum range are refused when the table is built
+  REQUIRE_THROWS_AS( ( fsm::DenseTransitionTable< DOOREVENT, DOORSTATE >(
+                         std::vector< fsm::EventTableEntry< DOOREVENT, DOORSTATE > >{ { DOOREVENT::OPEN, DOORSTATE::COUNT, DOORSTATE::OPENED } } ) ),
+                     std::out_of_range );
+}
+
 // test config parser
 TEST_CASE( "Parse FSM test" )
 {
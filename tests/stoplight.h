@@ -1,7 +1,10 @@
+#include <atomic>
 #include <functional>
+#include <harmony_fsm/dense_finite_state_machine.hpp>
 #include <harmony_fsm/finite_state_machine.hpp>
 #include <harmony_fsm/fsm_rate.hpp>
 #include <harmony_fsm/fsm_runner.hpp>
+#include <harmony_fsm/static_finite_state_machine.hpp>
 #include <iostream>
 #include <map>
 #include <stdexcept>
@@ -23,6 +26,21 @@ enum class RUNSTATE : unsigned
   EMERGENCY
 };
 
+namespace fsm
+{
+template <>
+struct EnumTraits< EVENT >
+{
+  static constexpr std::size_t count = 3;
+};
+
+template <>
+struct EnumTraits< RUNSTATE >
+{
+  static constexpr std::size_t count = 4;
+};
+}  // namespace fsm
+
 enum class RUNRESULT
 {
   CYCLE_COMPLETE,
@@ -44,6 +62,16 @@ static const std::vector< fsm::EventTableEntry< EVENT, RUNSTATE > > STOPLIGHT_FS
     // back to red when emergency is done
     { EVENT::EMERGENCY_ENDED, RUNSTATE::EMERGENCY, RUNSTATE::RED } };
 
+// compile time format
+static constexpr std::array< fsm::EventTableEntry< EVENT, RUNSTATE >, 7 > STOPLIGHT_FSM_ARRAY = { {
+    { EVENT::DO_NEXT_CYCLE, RUNSTATE::GREEN, RUNSTATE::YELLOW },
+    { EVENT::DO_NEXT_CYCLE, RUNSTATE::YELLOW, RUNSTATE::RED },
+    { EVENT::DO_NEXT_CYCLE, RUNSTATE::RED, RUNSTATE::GREEN },
+    { EVENT::EMERGENCY_DECLARED, RUNSTATE::GREEN, RUNSTATE::EMERGENCY },
+    { EVENT::EMERGENCY_DECLARED, RUNSTATE::YELLOW, RUNSTATE::EMERGENCY },
+    { EVENT::EMERGENCY_DECLARED, RUNSTATE::RED, RUNSTATE::EMERGENCY },
+    { EVENT::EMERGENCY_ENDED, RUNSTATE::EMERGENCY, RUNSTATE::RED } } };
+
 // map format
 static const std::map < RUNSTATE, std::map < EVENT, RUNSTATE > > STOPLIGHT_FSM_MAP = {
     { RUNSTATE::GREEN, { 
@@ -61,20 +89,25 @@ static const std::map < RUNSTATE, std::map < EVENT, RUNSTATE > > STOPLIGHT_FSM_M
     { RUNSTATE::EMERGENCY, { 
       { EVENT::EMERGENCY_ENDED, RUNSTATE::RED } } } };
 
+// timers and polling run on TClock, which also times the runner. The state functions read the time of the step
+// published by the runner
+template < typename TClock >
 class StopLightOperation
 {
+  using CycleClock = fsm::FSMCycleBaseClock< TClock >;
+
  public:
-  StopLightOperation( bool byFuncMap,
-#ifdef USE_ROS_TIME
-                      fsm::FiniteStateMachineRunner< EVENT, RUNSTATE, fsm::UnusedCommandParameter, RUNRESULT, fsm::FSMROSClock >&& runner )
-#else
-                      fsm::FiniteStateMachineRunner< EVENT, RUNSTATE, fsm::UnusedCommandParameter, RUNRESULT, fsm::FSMSteadyClock >&& runner )
-#endif
+  // By default poll() re-kicks a running state. rekick_on_result polls it again from the completion handler
+  // instead, which needs a runner pacing its results, e.g. setPacedCompletion( true ), or it busy-loops.
+  StopLightOperation( bool                                                                                                byFuncMap,
+                      fsm::FiniteStateMachineRunnerBase< EVENT, RUNSTATE, fsm::UnusedCommandParameter, RUNRESULT, TClock >&& runner,
+                      bool                                                                                                rekick_on_result = false )
     : runner_( runner )
+    , rekick_on_result_( rekick_on_result )
   {
-    timers_.emplace( RUNSTATE::RED, fsm::SteadyTimer( 5 ) );
-    timers_.emplace( RUNSTATE::YELLOW, fsm::SteadyTimer( 3 ) );
-    timers_.emplace( RUNSTATE::GREEN, fsm::SteadyTimer( 5 ) );
+    timers_.emplace( RUNSTATE::RED, fsm::BaseTimer< CycleClock >( 5 ) );
+    timers_.emplace( RUNSTATE::YELLOW, fsm::BaseTimer< CycleClock >( 3 ) );
+    timers_.emplace( RUNSTATE::GREEN, fsm::BaseTimer< CycleClock >( 5 ) );
 
     if ( byFuncMap )
     {
@@ -131,7 +164,7 @@ class StopLightOperation
 
   RUNRESULT doRed( const fsm::UnusedCommandParameter* param = nullptr )
   {
-    History.emplace_back( RUNSTATE::RED, fsm::FSMSteadyClock::toSec() );
+    History.emplace_back( RUNSTATE::RED, CycleClock::toSec() );
     std::cout << "RED EXECUTE" << std::endl;
     if ( RedExecuted )
       RedExecuted();
@@ -141,7 +174,7 @@ class StopLightOperation
 
   RUNRESULT doYellow( const fsm::UnusedCommandParameter* param = nullptr )
   {
-    History.emplace_back( RUNSTATE::YELLOW, fsm::FSMSteadyClock::toSec() );
+    History.emplace_back( RUNSTATE::YELLOW, CycleClock::toSec() );
     std::cout << "YELLOW EXECUTE" << std::endl;
     if ( YellowExecuted )
       YellowExecuted();
@@ -151,7 +184,7 @@ class StopLightOperation
 
   RUNRESULT doGreen( const fsm::UnusedCommandParameter* param = nullptr )
   {
-    History.emplace_back( RUNSTATE::GREEN, fsm::FSMSteadyClock::toSec() );
+    History.emplace_back( RUNSTATE::GREEN, CycleClock::toSec() );
     std::cout << "GREEN EXECUTE" << std::endl;
     if ( GreenExecuted )
       GreenExecuted();
@@ -161,7 +194,7 @@ class StopLightOperation
 
   RUNRESULT doEmergency( const fsm::UnusedCommandParameter* param = nullptr )
   {
-    History.emplace_back( RUNSTATE::EMERGENCY, fsm::FSMSteadyClock::toSec() );
+    History.emplace_back( RUNSTATE::EMERGENCY, CycleClock::toSec() );
     std::cout << "EMERGENCY EXECUTE" << std::endl;
     if ( EmergencyExecuted )
       EmergencyExecuted();
@@ -188,7 +221,7 @@ class StopLightOperation
       if ( StateCompleted )
       {
         StateCompleted( runner_.getCurrentState() );
-        CompletionHistory.emplace_back( runner_.getCurrentState(), fsm::FSMSteadyClock::toSec() );
+        CompletionHistory.emplace_back( runner_.getCurrentState(), TClock::toSec() );
       }
       auto evt = EVENT::DO_NEXT_CYCLE;
       if ( runner_.getCurrentState() == RUNSTATE::EMERGENCY )
@@ -201,11 +234,26 @@ class StopLightOperation
 
       runner_.doEventAndExecute( evt );
     }
-    else
+    else if ( rekick_on_result_ )
     {
       // kick current state again
       runner_.updateFSM();
     }
+    else
+    {
+      running_ = true;
+    }
+  }
+
+  /**
+   * @brief Kicks a running state again unless the completion handler does
+   */
+  void poll()
+  {
+    if ( running_.exchange( false ) )
+    {
+      runner_.updateFSM();
+    }
   }
 
   bool ResetEmergency = false;
@@ -222,10 +270,8 @@ class StopLightOperation
   std::map< RUNSTATE, std::function< RUNRESULT( const fsm::UnusedCommandParameter* ) > > FunctionMap;
 
  private:
-  std::map< RUNSTATE, fsm::SteadyTimer >                                                                         timers_;
-#ifdef USE_ROS_TIME
-  fsm::FiniteStateMachineRunner< EVENT, RUNSTATE, fsm::UnusedCommandParameter, RUNRESULT, fsm::FSMROSClock >& runner_;
-#else
-  fsm::FiniteStateMachineRunner< EVENT, RUNSTATE, fsm::UnusedCommandParameter, RUNRESULT, fsm::FSMSteadyClock >& runner_;
-#endif
+  std::map< RUNSTATE, fsm::BaseTimer< CycleClock > >                                                    timers_;
+  fsm::FiniteStateMachineRunnerBase< EVENT, RUNSTATE, fsm::UnusedCommandParameter, RUNRESULT, TClock >& runner_;
+  bool                                                                                                  rekick_on_result_;
+  std::atomic< bool >                                                                                   running_{ false };
 };